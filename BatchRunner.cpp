@@ -0,0 +1,186 @@
+#include "BatchRunner.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOB_HAVE_GLOB 1
+#include <glob.h>
+#endif
+
+namespace
+{
+    std::string trim(const std::string &s)
+    {
+        size_t b = s.find_first_not_of(" \t\r");
+        if (b == std::string::npos)
+            return "";
+        size_t e = s.find_last_not_of(" \t\r");
+        return s.substr(b, e - b + 1);
+    }
+
+    uint64_t file_size(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        return file.is_open() ? static_cast<uint64_t>(file.tellg()) : 0;
+    }
+
+    // Counting gate over estimated bytes in flight. A request larger than
+    // the whole budget is admitted once nothing else holds any.
+    class MemoryGate
+    {
+    public:
+        explicit MemoryGate(uint64_t budget) : budget_(budget) {}
+
+        void acquire(uint64_t bytes)
+        {
+            if (budget_ == 0)
+                return;
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&]
+                     { return in_use_ == 0 || in_use_ + bytes <= budget_; });
+            in_use_ += bytes;
+        }
+
+        void release(uint64_t bytes)
+        {
+            if (budget_ == 0)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                in_use_ -= bytes;
+            }
+            cv_.notify_all();
+        }
+
+    private:
+        uint64_t budget_;
+        uint64_t in_use_ = 0;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+    };
+}
+
+bool BatchRunner::read_manifest(const std::string &path, std::vector<BatchJob> &jobs, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        error = "cannot open manifest " + path;
+        return false;
+    }
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line))
+    {
+        ++line_no;
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t c1 = line.find(',');
+        size_t c2 = c1 == std::string::npos ? c1 : line.find(',', c1 + 1);
+        if (c2 == std::string::npos || line.find(',', c2 + 1) != std::string::npos)
+        {
+            error = path + ":" + std::to_string(line_no) + ": expected orders,trades,output";
+            return false;
+        }
+        BatchJob job;
+        job.order_filepath = trim(line.substr(0, c1));
+        job.trade_filepath = trim(line.substr(c1 + 1, c2 - c1 - 1));
+        job.output_filepath = trim(line.substr(c2 + 1));
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+bool BatchRunner::expand_glob(const std::string &pattern, const std::string &output_dir, std::vector<BatchJob> &jobs,
+                              std::string &error)
+{
+#ifdef LOB_HAVE_GLOB
+    glob_t matches;
+    int rc = glob(pattern.c_str(), 0, nullptr, &matches);
+    if (rc == GLOB_NOMATCH)
+    {
+        error = "no files match " + pattern;
+        return false;
+    }
+    if (rc != 0)
+    {
+        error = "cannot expand " + pattern;
+        return false;
+    }
+    std::vector<std::string> paths(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+    globfree(&matches);
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto &path : paths)
+    {
+        size_t slash = path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        size_t at = name.rfind("orders");
+        if (at == std::string::npos)
+        {
+            error = path + ": order file name must contain \"orders\"";
+            return false;
+        }
+        BatchJob job;
+        job.order_filepath = path;
+        job.trade_filepath = dir + std::string(name).replace(at, 6, "trades");
+        std::string out_name = std::string(name).replace(at, 6, "metrics");
+        out_name = out_name.substr(0, out_name.rfind('.')) + ".csv";
+        job.output_filepath = output_dir.empty() ? out_name : output_dir + "/" + out_name;
+        for (const auto &other : jobs)
+        {
+            if (other.output_filepath == job.output_filepath)
+            {
+                error = other.order_filepath + " and " + path + " both map to " + job.output_filepath + "; use a manifest";
+                return false;
+            }
+        }
+        jobs.push_back(job);
+    }
+    return true;
+#else
+    (void)pattern;
+    (void)output_dir;
+    (void)jobs;
+    error = "file globs are not supported on this platform; use a manifest";
+    return false;
+#endif
+}
+
+std::vector<BatchResult> BatchRunner::run(std::vector<BatchJob> &jobs, size_t workers, uint64_t memory_budget_bytes,
+                                          bool streaming, const Replay &replay)
+{
+    for (auto &job : jobs)
+        job.input_bytes = file_size(job.order_filepath) + file_size(job.trade_filepath);
+
+    // Largest first; ties keep job order
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                     { return jobs[a].input_bytes > jobs[b].input_bytes; });
+
+    std::vector<BatchResult> results(jobs.size());
+    MemoryGate gate(memory_budget_bytes);
+    ThreadPool pool(std::min(workers > 0 ? workers : ThreadPool::default_size(), std::max<size_t>(jobs.size(), 1)));
+    for (size_t idx : order)
+    {
+        pool.submit([&, idx]
+                    {
+            const BatchJob &job = jobs[idx];
+            uint64_t estimate = streaming ? STREAMING_RESIDENT_BYTES : job.input_bytes * RESIDENT_PER_INPUT_BYTE;
+            gate.acquire(estimate);
+            auto start = std::chrono::steady_clock::now();
+            results[idx].status = replay(job);
+            results[idx].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            gate.release(estimate); });
+    }
+    pool.wait_idle();
+    return results;
+}
@@ -0,0 +1,61 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// One independent replay: a day's order and trade files and where its
+// metrics go
+struct BatchJob
+{
+    std::string order_filepath;
+    std::string trade_filepath;
+    std::string output_filepath;
+    uint64_t input_bytes = 0; // filled in by BatchRunner::run
+};
+
+struct BatchResult
+{
+    int status = 0; // the replay's return code
+    double seconds = 0.0;
+};
+
+// Runs many replays on a bounded worker pool. Jobs start largest input
+// first so the long days do not end up last, and a memory budget holds
+// back jobs while the estimated footprint of those in flight is too high.
+// Each job writes only its own files, so outputs do not depend on the
+// worker count; results come back in job order.
+namespace BatchRunner
+{
+    using Replay = std::function<int(const BatchJob &job)>;
+
+    // Peak resident memory of an in-memory replay per byte of CSV input,
+    // measured on NSE order/trade files; used to charge jobs to the budget
+    const uint64_t RESIDENT_PER_INPUT_BYTE = 4;
+    // A streaming replay holds only the reorder window and the live books,
+    // which do not grow with the input (about 20 MiB on a 50 MB NSE day)
+    const uint64_t STREAMING_RESIDENT_BYTES = 64u << 20;
+
+    // Manifest: one "orders,trades,output" triple per line; blank lines and
+    // lines starting with '#' are skipped
+    bool read_manifest(const std::string &path, std::vector<BatchJob> &jobs, std::string &error);
+
+    // Every order file matching pattern, paired with the trade file at the
+    // same path with the last "orders" replaced by "trades". Outputs go to
+    // output_dir, named after the order file with "orders" -> "metrics".
+    // Matches are sorted, so the job list is stable. Two matches mapping to
+    // the same output are an error.
+    bool expand_glob(const std::string &pattern, const std::string &output_dir, std::vector<BatchJob> &jobs,
+                     std::string &error);
+
+    // memory_budget_bytes caps the estimated resident memory of the jobs in
+    // flight (0 = no cap); a job estimated above the cap runs alone.
+    // streaming says the replays stream, so each is charged a fixed estimate.
+    std::vector<BatchResult> run(std::vector<BatchJob> &jobs, size_t workers, uint64_t memory_budget_bytes,
+                                 bool streaming, const Replay &replay);
+}
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,203 @@
+#include "BookManager.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+BookManager::BookManager(size_t num_workers, const OrderBookConfig &book_config)
+    : pool_(num_workers), book_config_(book_config), books_{} {}
+
+BookManager::TokenBook &BookManager::slot(uint64_t token)
+{
+    return books_.try_emplace(token, book_config_).first->second;
+}
+
+OrderBook &BookManager::book(uint64_t token)
+{
+    return slot(token).book;
+}
+
+const OrderBook *BookManager::find_book(uint64_t token) const
+{
+    auto it = books_.find(token);
+    return it == books_.end() ? nullptr : &it->second.book;
+}
+
+size_t BookManager::events_processed(uint64_t token) const
+{
+    auto it = books_.find(token);
+    return it == books_.end() ? 0 : it->second.events_processed;
+}
+
+std::vector<uint64_t> BookManager::tokens() const
+{
+    std::vector<uint64_t> out;
+    out.reserve(books_.size());
+    for (const auto &kv : books_)
+        out.push_back(kv.first);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+OrderBook &BookManager::process_event(const Event &event)
+{
+    TokenBook &tb = slot(event.token);
+    tb.book.process_event(event);
+    ++tb.events_processed;
+    return tb.book;
+}
+
+// Greedy longest-processing-time assignment: busiest tokens first, each onto
+// the currently lightest shard. Ties break on token id so the layout is
+// deterministic. Books are created here, before any worker starts, so the
+// map is never mutated concurrently.
+std::vector<std::vector<size_t>> BookManager::shard_events(const EventStore &events)
+{
+    // Loads are counted per token index, so no hashing in the counting pass
+    const std::vector<PackedEvent> &hot = events.hot();
+    const std::vector<uint64_t> &tokens = events.tokens();
+    std::vector<size_t> index_load(tokens.size(), 0);
+    for (const auto &e : hot)
+        ++index_load[e.token_index()];
+
+    std::vector<std::pair<uint64_t, size_t>> by_load;
+    std::unordered_map<uint64_t, uint32_t> token_of;
+    for (uint32_t t = 0; t < tokens.size(); ++t)
+    {
+        if (index_load[t] == 0)
+            continue;
+        by_load.emplace_back(tokens[t], index_load[t]);
+        token_of[tokens[t]] = t;
+    }
+    std::sort(by_load.begin(), by_load.end(), [](const std::pair<uint64_t, size_t> &a, const std::pair<uint64_t, size_t> &b)
+              { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+
+    size_t num_shards = std::min(pool_.size(), by_load.size());
+    std::vector<size_t> shard_load(num_shards, 0);
+    std::vector<size_t> index_shard(tokens.size(), 0);
+    for (const auto &tl : by_load)
+    {
+        size_t target = std::min_element(shard_load.begin(), shard_load.end()) - shard_load.begin();
+        shard_load[target] += tl.second;
+        index_shard[token_of[tl.first]] = target;
+        slot(tl.first);
+    }
+
+    std::vector<std::vector<size_t>> shards(num_shards);
+    for (size_t s = 0; s < num_shards; ++s)
+        shards[s].reserve(shard_load[s]);
+    for (size_t i = 0; i < hot.size(); ++i)
+        shards[index_shard[hot[i].token_index()]].push_back(i);
+    return shards;
+}
+
+void BookManager::replay(const EventStore &events, const EventHandler &on_event, const EventHandler &before_event)
+{
+    std::vector<std::vector<size_t>> shards = shard_events(events);
+    for (const auto &shard : shards)
+    {
+        pool_.submit([this, &events, &shard, &on_event, &before_event]
+                     {
+            // Cache the last slot: consecutive events usually share a token
+            uint64_t cached_token = 0;
+            TokenBook *tb = nullptr;
+            for (size_t idx : shard)
+            {
+                const Event event = events.at(idx);
+                if (!tb || event.token != cached_token)
+                {
+                    tb = &books_.find(event.token)->second;
+                    cached_token = event.token;
+                }
+                if (before_event)
+                    before_event(tb->book, event, tb->events_processed);
+                tb->book.process_event(event);
+                size_t seq = tb->events_processed++;
+                if (on_event)
+                    on_event(tb->book, event, seq);
+            } });
+    }
+    pool_.wait_idle();
+}
+
+bool BookManager::save_checkpoint(const std::string &path, const CheckpointInfo &info, std::string &error) const
+{
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Checkpoint::MAGIC, sizeof(header.magic));
+    header.version = Checkpoint::VERSION;
+    header.token_count = static_cast<uint32_t>(books_.size());
+    header.input_offset = info.input_offset;
+    header.timestamp = info.timestamp;
+    header.input_size = info.input_size;
+
+    // Written to a temporary name first so a crash never leaves a torn file
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        error = "cannot open " + tmp_path + " for writing";
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    CheckpointWriter state;
+    for (uint64_t token : tokens())
+    {
+        const TokenBook &tb = books_.find(token)->second;
+        state.clear();
+        tb.book.save_state(state);
+        uint64_t fields[3] = {token, tb.events_processed, state.size()};
+        out.write(reinterpret_cast<const char *>(fields), sizeof(fields));
+        out.write(state.data().data(), state.size());
+    }
+    out.close();
+    if (out.fail() || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        error = "writing " + path + " failed";
+        return false;
+    }
+    return true;
+}
+
+bool BookManager::load_checkpoint(const std::string &path, CheckpointInfo &info, std::string &error)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    CheckpointReader in(file.data(), file.size());
+    CheckpointHeader header;
+    if (!in.get(header) || std::memcmp(header.magic, Checkpoint::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != Checkpoint::VERSION)
+    {
+        error = path + " is not a supported checkpoint";
+        return false;
+    }
+
+    books_.clear();
+    for (uint32_t t = 0; t < header.token_count; ++t)
+    {
+        uint64_t fields[3];
+        bool ok = in.get(fields) && fields[2] <= in.remaining();
+        if (ok)
+        {
+            TokenBook &tb = slot(fields[0]);
+            tb.events_processed = fields[1];
+            CheckpointReader state(in.position(), fields[2]);
+            ok = tb.book.load_state(state) && state.remaining() == 0 && in.skip(fields[2]);
+        }
+        if (!ok)
+        {
+            books_.clear();
+            error = path + ": corrupt state for token " + std::to_string(t);
+            return false;
+        }
+    }
+    info.input_offset = header.input_offset;
+    info.timestamp = header.timestamp;
+    info.input_size = header.input_size;
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef BOOKMANAGER_H
+#define BOOKMANAGER_H
+
+#include "EventStore.h"
+#include "OrderBook.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Owns one OrderBook per instrument token and routes events by Event::token.
+// Bulk replays shard tokens across a fixed worker pool; a token is always
+// handled by a single worker, so each book stays single-threaded.
+class BookManager
+{
+public:
+    // Called on the worker thread after an event has been applied to its book.
+    // seq is the 0-based index of the event within that token's stream.
+    using EventHandler = std::function<void(OrderBook &book, const Event &event, size_t seq)>;
+
+    explicit BookManager(size_t num_workers = 0, const OrderBookConfig &book_config = OrderBookConfig()); // 0 = hardware concurrency
+
+    // Sequential routing, for callers that drive the books event by event
+    OrderBook &process_event(const Event &event);
+
+    // Replays a timestamp-sorted event vector. Each worker walks its shard in
+    // input order, so every token sees its events in timestamp order.
+    // before_event, when set, sees the book just before each event is applied,
+    // with the seq the event is about to get.
+    void replay(const EventStore &events, const EventHandler &on_event = nullptr,
+                const EventHandler &before_event = nullptr);
+
+    OrderBook &book(uint64_t token);
+    const OrderBook *find_book(uint64_t token) const;
+    size_t events_processed(uint64_t token) const;
+    std::vector<uint64_t> tokens() const; // ascending
+    size_t book_count() const { return books_.size(); }
+    size_t worker_count() const { return pool_.size(); }
+
+    // Checkpoint of every book and its event count (see Checkpoint.h). Load
+    // replaces all books, so call it before attaching any listener.
+    bool save_checkpoint(const std::string &path, const CheckpointInfo &info, std::string &error) const;
+    bool load_checkpoint(const std::string &path, CheckpointInfo &info, std::string &error);
+
+private:
+    struct TokenBook
+    {
+        explicit TokenBook(const OrderBookConfig &config) : book(config) {}
+
+        OrderBook book;
+        size_t events_processed = 0;
+    };
+
+    TokenBook &slot(uint64_t token);
+    std::vector<std::vector<size_t>> shard_events(const EventStore &events);
+
+    ThreadPool pool_;
+    OrderBookConfig book_config_;
+    std::unordered_map<uint64_t, TokenBook> books_;
+};
+
+#endif // BOOKMANAGER_H
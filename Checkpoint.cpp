@@ -0,0 +1,11 @@
+#include "Checkpoint.h"
+
+const char Checkpoint::MAGIC[8] = {'L', 'O', 'B', 'C', 'K', 'P', 'T', '\0'};
+
+std::string Checkpoint::file_name(const std::string &dir, uint64_t input_offset)
+{
+    std::string name = "checkpoint_" + std::to_string(input_offset) + ".lobckpt";
+    if (dir.empty())
+        return name;
+    return dir.back() == '/' ? dir + name : dir + "/" + name;
+}
@@ -0,0 +1,103 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Where in the input a checkpoint was taken. input_offset counts events
+// consumed in replay order, so resuming skips exactly that many.
+struct CheckpointInfo
+{
+    uint64_t input_offset = 0;
+    uint64_t timestamp = 0;  // raw timestamp of the last event applied
+    uint64_t input_size = 0; // total bytes of the input files, to catch a mismatched resume
+};
+
+// Append-only little-endian byte buffer for book state
+class CheckpointWriter
+{
+public:
+    template <typename T>
+    void put(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be plain data");
+        const char *p = reinterpret_cast<const char *>(&value);
+        buffer_.insert(buffer_.end(), p, p + sizeof(T));
+    }
+
+    const std::vector<char> &data() const { return buffer_; }
+    size_t size() const { return buffer_.size(); }
+    void clear() { buffer_.clear(); }
+
+private:
+    std::vector<char> buffer_;
+};
+
+// Bounds-checked reader over a CheckpointWriter's bytes. A short read
+// fails and latches, so callers can check ok() once at the end.
+class CheckpointReader
+{
+public:
+    CheckpointReader(const char *data, size_t size) : p_(data), end_(data + size) {}
+
+    template <typename T>
+    bool get(T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be plain data");
+        if (!ok_ || static_cast<size_t>(end_ - p_) < sizeof(T))
+            return ok_ = false;
+        std::memcpy(&value, p_, sizeof(T));
+        p_ += sizeof(T);
+        return true;
+    }
+
+    // Steps over n bytes, e.g. a nested block read with its own reader
+    bool skip(size_t n)
+    {
+        if (!ok_ || remaining() < n)
+            return ok_ = false;
+        p_ += n;
+        return true;
+    }
+
+    bool ok() const { return ok_; }
+    void fail() { ok_ = false; }
+    const char *position() const { return p_; }
+    size_t remaining() const { return end_ - p_; }
+
+private:
+    const char *p_;
+    const char *end_;
+    bool ok_ = true;
+};
+
+// Checkpoint file (.lobckpt), little-endian:
+//   CheckpointHeader
+//   per token: uint64_t token, uint64_t events_processed, uint64_t state_size,
+//              state_size bytes of OrderBook::save_state
+struct CheckpointHeader
+{
+    char magic[8]; // "LOBCKPT\0"
+    uint32_t version;
+    uint32_t token_count;
+    uint64_t input_offset;
+    uint64_t timestamp;
+    uint64_t input_size;
+};
+
+static_assert(sizeof(CheckpointHeader) == 40, "CheckpointHeader layout changed");
+
+namespace Checkpoint
+{
+    const uint32_t VERSION = 3; // 2, 3: ReconcileStats gained unmatched_trades, anonymous_trades
+    extern const char MAGIC[8];
+
+    // Default file name for a checkpoint taken after input_offset events
+    std::string file_name(const std::string &dir, uint64_t input_offset);
+}
+
+#endif // CHECKPOINT_H
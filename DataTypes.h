@@ -61,7 +61,7 @@ struct Event
         uint64_t uid = 0,
         uint64_t boid = 0,
         uint64_t soid = 0) : timestamp(ts), type(t), order_id(oid), price(p), quantity(q), side(s),
-                             user_id(uid), buy_order_id(boid), sell_order_id(soid) {}
+                             token(0), user_id(uid), buy_order_id(boid), sell_order_id(soid) {}
 };
 
 #endif // DATATYPES_H
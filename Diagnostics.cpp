@@ -0,0 +1,286 @@
+#include "Diagnostics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // Bounded multi-producer/single-consumer ring: each cell's sequence
+    // number says whether it is free for the producer at that position or
+    // holds a record for the consumer
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        DiagRecord record;
+    };
+
+    struct State
+    {
+        State()
+        {
+            for (size_t i = 0; i < Diagnostics::RING_CAPACITY; ++i)
+                cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> counts[static_cast<size_t>(DiagReason::COUNT)] = {};
+        std::atomic<uint64_t> dropped{0};
+        Cell cells[Diagnostics::RING_CAPACITY];
+        alignas(64) std::atomic<size_t> tail{0}; // next position to claim
+        alignas(64) size_t head = 0;             // consumer position
+    };
+
+    State &state()
+    {
+        static State s;
+        return s;
+    }
+
+    thread_local DiagnosticsBuffer *current_sink = nullptr;
+
+    void fill(DiagRecord &r, DiagReason reason, uint64_t order_id, uint64_t timestamp, uint64_t token, int price,
+              int quantity, char side, std::string_view detail)
+    {
+        r.timestamp = timestamp;
+        r.order_id = order_id;
+        r.token = static_cast<uint32_t>(token);
+        r.price = price;
+        r.quantity = quantity;
+        r.reason = reason;
+        r.side = side;
+        size_t n = std::min(detail.size(), DiagRecord::DETAIL_BYTES - 1);
+        std::memcpy(r.detail, detail.data(), n);
+        r.detail[n] = '\0';
+    }
+
+    const size_t MASK = Diagnostics::RING_CAPACITY - 1;
+    static_assert((Diagnostics::RING_CAPACITY & MASK) == 0, "ring capacity must be a power of two");
+}
+
+void Diagnostics::record(DiagReason reason, uint64_t order_id, uint64_t timestamp, uint64_t token, int price,
+                         int quantity, char side, std::string_view detail)
+{
+    State &s = state();
+    s.counts[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+
+    if (current_sink)
+    {
+        DiagRecord r;
+        fill(r, reason, order_id, timestamp, token, price, quantity, side, detail);
+        current_sink->add(r);
+        return;
+    }
+
+    size_t pos = s.tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true)
+    {
+        cell = &s.cells[pos & MASK];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0 && s.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        if (diff < 0)
+        {
+            s.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (diff > 0)
+            pos = s.tail.load(std::memory_order_relaxed);
+    }
+
+    fill(cell->record, reason, order_id, timestamp, token, price, quantity, side, detail);
+    cell->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool Diagnostics::try_pop(DiagRecord &record)
+{
+    State &s = state();
+    Cell &cell = s.cells[s.head & MASK];
+    if (cell.seq.load(std::memory_order_acquire) != s.head + 1)
+        return false;
+    record = cell.record;
+    cell.seq.store(s.head + RING_CAPACITY, std::memory_order_release);
+    ++s.head;
+    return true;
+}
+
+DiagnosticsBuffer *Diagnostics::sink()
+{
+    return current_sink;
+}
+
+void Diagnostics::set_sink(DiagnosticsBuffer *sink)
+{
+    current_sink = sink;
+}
+
+uint64_t Diagnostics::count(DiagReason reason)
+{
+    return state().counts[static_cast<size_t>(reason)].load(std::memory_order_relaxed);
+}
+
+uint64_t Diagnostics::dropped()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+const char *Diagnostics::reason_name(DiagReason reason)
+{
+    switch (reason)
+    {
+    case DiagReason::SELF_TRADE_REJECTED:
+        return "self_trade_rejected";
+    case DiagReason::SELF_TRADE_ON_MATCH:
+        return "self_trade_on_match";
+    case DiagReason::INVALID_ORDER:
+        return "invalid_order";
+    case DiagReason::UNKNOWN_SIDE:
+        return "unknown_side";
+    case DiagReason::CORRUPT_LINE:
+        return "corrupt_line";
+    case DiagReason::UNKNOWN_ORDER_TYPE:
+        return "unknown_order_type";
+    default:
+        return "unknown";
+    }
+}
+
+// Same wording the hot paths used to print directly
+void Diagnostics::format(const DiagRecord &r, std::ostream &os)
+{
+    switch (r.reason)
+    {
+    case DiagReason::SELF_TRADE_REJECTED:
+        os << "[OrderBook] Self-trade detected, order_id " << r.order_id << "; Ignored.\n";
+        break;
+    case DiagReason::SELF_TRADE_ON_MATCH:
+        os << "[OrderBook] Prevented " << (r.side == 'B' ? "BUY" : "SELL") << " self-trade on match (order_id="
+           << r.order_id << ")\n";
+        break;
+    case DiagReason::INVALID_ORDER:
+        os << "[OrderBook] Invalid order: price/quantity must be > 0 (order_id=" << r.order_id << ")\n";
+        break;
+    case DiagReason::UNKNOWN_SIDE:
+        os << "[OrderBook] Attempt to add order with unknown side (order_id=" << r.order_id << ")\n";
+        break;
+    case DiagReason::CORRUPT_LINE:
+        os << "[parse_line] Corrupt line: " << r.detail << "\n";
+        break;
+    case DiagReason::UNKNOWN_ORDER_TYPE:
+        os << "[parse_line] Unknown order type in line: " << r.detail << "\n";
+        break;
+    default:
+        break;
+    }
+}
+
+void Diagnostics::report(std::ostream &os)
+{
+    bool any = false;
+    for (size_t i = 0; i < static_cast<size_t>(DiagReason::COUNT); ++i)
+    {
+        uint64_t n = count(static_cast<DiagReason>(i));
+        if (n == 0)
+            continue;
+        os << (any ? ", " : "[diag] ") << reason_name(static_cast<DiagReason>(i)) << "=" << n;
+        any = true;
+    }
+    if (any)
+        os << " (" << dropped() << " records dropped on a full ring)\n";
+}
+
+// --- DiagnosticsBuffer ---
+
+void DiagnosticsBuffer::add(const DiagRecord &record)
+{
+    counts_[static_cast<size_t>(record.reason)].fetch_add(1, std::memory_order_relaxed);
+    size_t slot = next_.fetch_add(1, std::memory_order_relaxed);
+    if (slot < CAPACITY)
+        records_[slot] = record;
+}
+
+void DiagnosticsBuffer::report(std::ostream &os) const
+{
+    size_t added = next_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < std::min(added, CAPACITY); ++i)
+        Diagnostics::format(records_[i], os);
+    if (added > CAPACITY)
+        os << "[diag] " << added - CAPACITY << " message(s) suppressed\n";
+    bool any = false;
+    for (size_t i = 0; i < static_cast<size_t>(DiagReason::COUNT); ++i)
+    {
+        uint64_t n = counts_[i].load(std::memory_order_relaxed);
+        if (n == 0)
+            continue;
+        os << (any ? ", " : "[diag] ") << Diagnostics::reason_name(static_cast<DiagReason>(i)) << "=" << n;
+        any = true;
+    }
+    if (any)
+        os << "\n";
+}
+
+// --- DiagnosticsDrain ---
+
+struct DiagnosticsDrain::Impl
+{
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+};
+
+void DiagnosticsDrain::start(std::ostream &os, size_t max_per_second)
+{
+    if (impl_)
+        return;
+    impl_ = new Impl();
+    Impl *impl = impl_;
+    impl_->thread = std::thread([impl, &os, max_per_second]
+                                {
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point window = Clock::now();
+        size_t printed = 0;
+        uint64_t suppressed = 0;
+        DiagRecord record;
+        while (true)
+        {
+            bool stopping = impl->stopping.load(std::memory_order_acquire);
+            bool drained_any = false;
+            while (Diagnostics::try_pop(record))
+            {
+                drained_any = true;
+                Clock::time_point now = Clock::now();
+                if (now - window >= std::chrono::seconds(1))
+                {
+                    if (suppressed > 0)
+                        os << "[diag] " << suppressed << " message(s) suppressed\n";
+                    window = now;
+                    printed = 0;
+                    suppressed = 0;
+                }
+                if (printed < max_per_second)
+                {
+                    Diagnostics::format(record, os);
+                    ++printed;
+                }
+                else
+                    ++suppressed;
+            }
+            if (stopping)
+                break;
+            if (!drained_any)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (suppressed > 0)
+            os << "[diag] " << suppressed << " message(s) suppressed\n";
+        os.flush(); });
+}
+
+void DiagnosticsDrain::stop()
+{
+    if (!impl_)
+        return;
+    impl_->stopping.store(true, std::memory_order_release);
+    impl_->thread.join();
+    delete impl_;
+    impl_ = nullptr;
+}
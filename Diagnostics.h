@@ -0,0 +1,125 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+
+// Why a diagnostic was raised
+enum class DiagReason : uint8_t
+{
+    SELF_TRADE_REJECTED, // incoming order dropped before matching (STP cancel-newest)
+    SELF_TRADE_ON_MATCH, // remainder dropped on reaching an own resting order
+    INVALID_ORDER,       // price or quantity <= 0
+    UNKNOWN_SIDE,
+    CORRUPT_LINE,
+    UNKNOWN_ORDER_TYPE,
+    COUNT
+};
+
+// Fixed-size binary log record, one cache line; formatting happens on the
+// drain thread
+struct DiagRecord
+{
+    static constexpr size_t DETAIL_BYTES = 34;
+
+    uint64_t timestamp; // event timestamp, 0 when there is none
+    uint64_t order_id;
+    uint32_t token;     // NSE tokens fit in 32 bits
+    int32_t price;
+    int32_t quantity;
+    DiagReason reason;
+    char side;                  // 'B', 'S' or 0
+    char detail[DETAIL_BYTES];  // truncated source text (corrupt lines), NUL-terminated
+};
+
+static_assert(sizeof(DiagRecord) == 64, "DiagRecord layout changed");
+
+// Diagnostics of the threads routed to it, for a run that writes its own log
+// (a batch day). They skip the shared ring and its rate limit: the first
+// CAPACITY records are kept in the order they were raised and the rest are
+// only counted, so the log depends on nothing but the run's own input.
+class DiagnosticsBuffer
+{
+public:
+    static constexpr size_t CAPACITY = 32;
+
+    void add(const DiagRecord &record);
+    // Kept records, what was left out, then per-reason totals. Call once
+    // every thread routed here has finished.
+    void report(std::ostream &os) const;
+
+private:
+    std::atomic<uint64_t> counts_[static_cast<size_t>(DiagReason::COUNT)] = {};
+    std::atomic<size_t> next_{0}; // records added, kept or not
+    DiagRecord records_[CAPACITY];
+};
+
+// Process-wide diagnostics for the matching and parsing hot paths. record()
+// bumps a per-reason atomic counter and tries to enqueue the record into a
+// bounded lock-free ring; when the ring is full the record is dropped (and
+// counted), never waited for. Threads routed to a DiagnosticsBuffer add to
+// it instead of the ring. No formatting, allocation or I/O happens on the
+// calling thread.
+class Diagnostics
+{
+public:
+    static constexpr size_t RING_CAPACITY = 4096;
+
+    static void record(DiagReason reason, uint64_t order_id, uint64_t timestamp = 0, uint64_t token = 0,
+                       int price = 0, int quantity = 0, char side = 0, std::string_view detail = std::string_view());
+
+    static uint64_t count(DiagReason reason);
+    static uint64_t dropped(); // records lost to a full ring
+    static const char *reason_name(DiagReason reason);
+
+    static void format(const DiagRecord &record, std::ostream &os);
+    static void report(std::ostream &os); // per-reason counters, non-zero only
+
+    // Consumer side of the ring; only one thread may call it
+    static bool try_pop(DiagRecord &record);
+
+    // Per-thread routing of records; ThreadPool tasks inherit the submitting
+    // thread's sink
+    static DiagnosticsBuffer *sink();
+    static void set_sink(DiagnosticsBuffer *sink);
+};
+
+// Routes the current thread's records to sink for the scope's lifetime
+class DiagnosticsSinkScope
+{
+public:
+    explicit DiagnosticsSinkScope(DiagnosticsBuffer *sink) : previous_(Diagnostics::sink())
+    {
+        Diagnostics::set_sink(sink);
+    }
+    ~DiagnosticsSinkScope() { Diagnostics::set_sink(previous_); }
+    DiagnosticsSinkScope(const DiagnosticsSinkScope &) = delete;
+    DiagnosticsSinkScope &operator=(const DiagnosticsSinkScope &) = delete;
+
+private:
+    DiagnosticsBuffer *previous_;
+};
+
+// Background thread that drains the diagnostics ring to a stream, printing
+// at most max_per_second records per second and a count of the rest
+class DiagnosticsDrain
+{
+public:
+    DiagnosticsDrain() = default;
+    ~DiagnosticsDrain() { stop(); }
+    DiagnosticsDrain(const DiagnosticsDrain &) = delete;
+    DiagnosticsDrain &operator=(const DiagnosticsDrain &) = delete;
+
+    void start(std::ostream &os, size_t max_per_second = 20);
+    void stop(); // drains what is left, then joins
+
+private:
+    struct Impl;
+    Impl *impl_ = nullptr;
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,134 @@
+#include "EventFile.h"
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const char MAGIC[8] = {'L', 'O', 'B', 'E', 'V', 'T', '\0', '\0'};
+}
+
+bool EventFile::write(const std::string &path, const EventStore &events, std::string &error)
+{
+    const std::vector<PackedEvent> &hot = events.hot();
+    EventFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.record_size = sizeof(PackedEvent);
+    header.token_count = static_cast<uint32_t>(events.tokens().size());
+    header.cold_size = sizeof(EventColdFields);
+    header.record_count = hot.size();
+    header.cold_count = events.cold().size();
+    header.first_timestamp = hot.empty() ? 0 : hot.front().timestamp;
+    header.last_timestamp = hot.empty() ? 0 : hot.back().timestamp;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    // The store's arrays are already in file layout
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(events.tokens().data()), events.tokens().size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(hot.data()), hot.size() * sizeof(PackedEvent));
+    out.write(reinterpret_cast<const char *>(events.cold().data()), events.cold().size() * sizeof(EventColdFields));
+    if (!out.good())
+    {
+        error = "write to " + path + " failed";
+        return false;
+    }
+    return true;
+}
+
+bool EventFileReader::open(const std::string &path, std::string &error)
+{
+    if (!file_.open(path))
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    if (file_.size() < sizeof(EventFileHeader))
+    {
+        error = path + ": truncated header";
+        return false;
+    }
+    const EventFileHeader *h = reinterpret_cast<const EventFileHeader *>(file_.data());
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error = path + ": not a LOB event capture";
+        return false;
+    }
+    if (h->version != EventFile::VERSION || h->record_size != sizeof(PackedEvent) ||
+        h->cold_size != sizeof(EventColdFields))
+    {
+        error = path + ": unsupported capture version " + std::to_string(h->version) + " (re-run lob_convert)";
+        return false;
+    }
+    // Each section is checked against what is left of the file, so a
+    // damaged count cannot wrap the size sum
+    size_t remaining = file_.size() - sizeof(EventFileHeader);
+    bool fits = h->token_count <= remaining / sizeof(uint64_t);
+    if (fits)
+    {
+        remaining -= h->token_count * sizeof(uint64_t);
+        fits = h->record_count <= remaining / sizeof(PackedEvent);
+    }
+    if (fits)
+    {
+        remaining -= h->record_count * sizeof(PackedEvent);
+        fits = h->cold_count <= remaining / sizeof(EventColdFields);
+    }
+    if (!fits)
+    {
+        error = path + ": truncated records";
+        return false;
+    }
+    if (h->token_count > PackedEvent::MAX_TOKENS)
+    {
+        error = path + ": " + std::to_string(h->token_count) + " tokens exceed the capture limit";
+        return false;
+    }
+    const uint64_t *tokens = reinterpret_cast<const uint64_t *>(file_.data() + sizeof(EventFileHeader));
+    const PackedEvent *records = reinterpret_cast<const PackedEvent *>(tokens + h->token_count);
+
+    // One pass up front keeps event() free of checks
+    for (uint64_t i = 0; i < h->record_count; ++i)
+    {
+        const PackedEvent &p = records[i];
+        if (p.token_index() >= h->token_count || (p.has_cold() && p.cold_index >= h->cold_count))
+        {
+            error = path + ": record " + std::to_string(i) + " points outside the token or cold table";
+            return false;
+        }
+    }
+    header_ = h;
+    tokens_ = tokens;
+    records_ = records;
+    cold_ = reinterpret_cast<const EventColdFields *>(records_ + h->record_count);
+    count_ = h->record_count;
+    return true;
+}
+
+Event EventFileReader::event(size_t i) const
+{
+    const PackedEvent &p = records_[i];
+    Event e(p.timestamp, p.type(), p.order_id, p.price, p.quantity, p.side());
+    e.token = tokens_[p.token_index()];
+    if (p.has_cold())
+    {
+        const EventColdFields &c = cold_[p.cold_index];
+        e.user_id = c.user_id;
+        e.buy_order_id = c.buy_order_id;
+        e.sell_order_id = c.sell_order_id;
+    }
+    return e;
+}
+
+bool EventFileReader::read_all(EventStore &out, std::string &error) const
+{
+    if (out.assign(tokens_, header_->token_count, records_, count_, cold_, header_->cold_count))
+        return true;
+    error = "capture token table lists a token twice";
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef EVENTFILE_H
+#define EVENTFILE_H
+
+#include "DataTypes.h"
+#include "EventStore.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary event capture (.lobevt), written once by lob_convert and replayed
+// by memory mapping it. Version 2 layout, little-endian:
+//   EventFileHeader
+//   uint64_t tokens[token_count]            token dictionary
+//   PackedEvent records[record_count]       in replay order, 32 bytes each
+//   EventColdFields cold[cold_count]        indexed by PackedEvent::cold_index
+// Version 1 files (48-byte wide records) must be regenerated with lob_convert.
+struct EventFileHeader
+{
+    char magic[8];         // "LOBEVT\0\0"
+    uint32_t version;      // EventFile::VERSION
+    uint32_t record_size;  // sizeof(PackedEvent)
+    uint32_t token_count;
+    uint32_t cold_size;    // sizeof(EventColdFields)
+    uint64_t record_count;
+    uint64_t cold_count;
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+};
+
+static_assert(sizeof(EventFileHeader) == 56, "EventFileHeader layout changed");
+
+namespace EventFile
+{
+    const uint32_t VERSION = 2;
+
+    // events must already be in replay order
+    bool write(const std::string &path, const EventStore &events, std::string &error);
+}
+
+// Validated, memory-mapped view of a capture file
+class EventFileReader
+{
+public:
+    bool open(const std::string &path, std::string &error);
+
+    size_t size() const { return count_; }
+    Event event(size_t i) const;
+    // Replaces out's contents; false if the token table repeats a token
+    bool read_all(EventStore &out, std::string &error) const;
+
+    const EventFileHeader &header() const { return *header_; }
+    const PackedEvent *records() const { return records_; }
+    const EventColdFields *cold() const { return cold_; }
+    const uint64_t *tokens() const { return tokens_; }
+
+private:
+    MappedFile file_;
+    const EventFileHeader *header_ = nullptr;
+    const uint64_t *tokens_ = nullptr;
+    const PackedEvent *records_ = nullptr;
+    const EventColdFields *cold_ = nullptr;
+    size_t count_ = 0;
+};
+
+#endif // EVENTFILE_H
@@ -0,0 +1,125 @@
+#include "EventStore.h"
+#include <utility>
+
+void EventStore::clear()
+{
+    hot_.clear();
+    cold_.clear();
+    tokens_.clear();
+    token_index_.clear();
+    last_index_ = UINT32_MAX;
+}
+
+void EventStore::swap(EventStore &other)
+{
+    hot_.swap(other.hot_);
+    cold_.swap(other.cold_);
+    tokens_.swap(other.tokens_);
+    token_index_.swap(other.token_index_);
+    std::swap(last_token_, other.last_token_);
+    std::swap(last_index_, other.last_index_);
+}
+
+uint32_t EventStore::intern(uint64_t token)
+{
+    if (last_index_ != UINT32_MAX && token == last_token_)
+        return last_index_;
+    auto it = token_index_.find(token);
+    uint32_t index;
+    if (it != token_index_.end())
+        index = it->second;
+    else
+    {
+        if (tokens_.size() >= PackedEvent::MAX_TOKENS)
+            return UINT32_MAX;
+        index = static_cast<uint32_t>(tokens_.size());
+        tokens_.push_back(token);
+        token_index_.emplace(token, index);
+    }
+    last_token_ = token;
+    last_index_ = index;
+    return index;
+}
+
+bool EventStore::push_back(const Event &event)
+{
+    uint32_t index = intern(event.token);
+    if (index == UINT32_MAX)
+        return false;
+    uint8_t kind = static_cast<uint8_t>(event.type) & PackedEvent::TYPE_MASK;
+    if (event.side == Side::SELL)
+        kind |= PackedEvent::SIDE_SELL;
+    PackedEvent p;
+    p.timestamp = event.timestamp;
+    p.order_id = event.order_id;
+    p.price = event.price;
+    p.quantity = event.quantity;
+    p.cold_index = 0;
+    if (event.user_id != 0 || event.buy_order_id != 0 || event.sell_order_id != 0)
+    {
+        kind |= PackedEvent::HAS_COLD;
+        p.cold_index = static_cast<uint32_t>(cold_.size());
+        cold_.push_back({event.user_id, event.buy_order_id, event.sell_order_id});
+    }
+    p.token_kind = index | (static_cast<uint32_t>(kind) << PackedEvent::TOKEN_BITS);
+    hot_.push_back(p);
+    return true;
+}
+
+std::vector<uint32_t> EventStore::adopt_tokens(const EventStore &from)
+{
+    std::vector<uint32_t> map(from.tokens_.size());
+    for (size_t i = 0; i < from.tokens_.size(); ++i)
+        map[i] = intern(from.tokens_[i]);
+    return map;
+}
+
+bool EventStore::append(const EventStore &from, size_t i, const std::vector<uint32_t> &token_map)
+{
+    PackedEvent p = from.hot_[i];
+    uint32_t index = token_map[p.token_index()];
+    if (index >= PackedEvent::MAX_TOKENS)
+        return false;
+    p.token_kind = index | (p.token_kind & ~(PackedEvent::MAX_TOKENS - 1));
+    if (p.has_cold())
+    {
+        cold_.push_back(from.cold_[p.cold_index]);
+        p.cold_index = static_cast<uint32_t>(cold_.size() - 1);
+    }
+    hot_.push_back(p);
+    return true;
+}
+
+Event EventStore::at(size_t i) const
+{
+    const PackedEvent &p = hot_[i];
+    Event e(p.timestamp, p.type(), p.order_id, p.price, p.quantity, p.side());
+    e.token = tokens_[p.token_index()];
+    if (p.has_cold())
+    {
+        const EventColdFields &c = cold_[p.cold_index];
+        e.user_id = c.user_id;
+        e.buy_order_id = c.buy_order_id;
+        e.sell_order_id = c.sell_order_id;
+    }
+    return e;
+}
+
+bool EventStore::assign(const uint64_t *tokens, size_t token_count, const PackedEvent *hot, size_t count,
+                        const EventColdFields *cold, size_t cold_count)
+{
+    clear();
+    if (token_count > PackedEvent::MAX_TOKENS)
+        return false;
+    for (size_t i = 0; i < token_count; ++i)
+    {
+        if (intern(tokens[i]) != i)
+        {
+            clear();
+            return false;
+        }
+    }
+    hot_.assign(hot, hot + count);
+    cold_.assign(cold, cold + cold_count);
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef EVENTSTORE_H
+#define EVENTSTORE_H
+
+#include "DataTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Fields most events leave at zero: the owner (STP) and a trade's two order
+// ids. Kept out of the hot record and stored only for events that have any.
+struct EventColdFields
+{
+    uint64_t user_id;
+    uint64_t buy_order_id;
+    uint64_t sell_order_id;
+};
+
+// 32-byte event as held in bulk. Type, side and a cold-fields flag share
+// one byte with a 24-bit index into the owning store's token table.
+struct PackedEvent
+{
+    static constexpr uint32_t TOKEN_BITS = 24;
+    static constexpr uint32_t MAX_TOKENS = 1u << TOKEN_BITS;
+    static constexpr uint8_t TYPE_MASK = 0x03;
+    static constexpr uint8_t SIDE_SELL = 0x04;
+    static constexpr uint8_t HAS_COLD = 0x08;
+
+    uint64_t timestamp;
+    uint64_t order_id;
+    int32_t price;
+    int32_t quantity;
+    uint32_t token_kind; // token index in the low 24 bits, kind flags in the top byte
+    uint32_t cold_index; // into the store's cold table when HAS_COLD is set
+
+    uint32_t token_index() const { return token_kind & (MAX_TOKENS - 1); }
+    uint8_t kind() const { return static_cast<uint8_t>(token_kind >> TOKEN_BITS); }
+    EventType type() const { return static_cast<EventType>(kind() & TYPE_MASK); }
+    Side side() const { return (kind() & SIDE_SELL) ? Side::SELL : Side::BUY; }
+    bool has_cold() const { return (kind() & HAS_COLD) != 0; }
+};
+
+static_assert(sizeof(PackedEvent) == 32, "PackedEvent layout changed");
+static_assert(sizeof(EventColdFields) == 24, "EventColdFields layout changed");
+
+// Bulk event container for sorting and replay: packed hot records, a cold
+// side table and the token dictionary the records index into. Sorting moves
+// only the 32-byte records; their cold_index travels with them.
+class EventStore
+{
+public:
+    size_t size() const { return hot_.size(); }
+    bool empty() const { return hot_.empty(); }
+    void reserve(size_t n) { hot_.reserve(n); }
+    void clear();
+    void swap(EventStore &other);
+
+    // False (event not stored) once MAX_TOKENS distinct tokens are in use
+    bool push_back(const Event &event);
+    // Copies from.hot()[i] in, remapping its token via token_map (see
+    // adopt_tokens). False (event not stored) if its token has no index.
+    bool append(const EventStore &from, size_t i, const std::vector<uint32_t> &token_map);
+    // Interns every token of from; result maps from's token index to ours,
+    // or to UINT32_MAX for tokens that no longer fit in MAX_TOKENS
+    std::vector<uint32_t> adopt_tokens(const EventStore &from);
+
+    Event at(size_t i) const; // Decoded wide event
+    uint64_t token(size_t i) const { return tokens_[hot_[i].token_index()]; }
+
+    const std::vector<PackedEvent> &hot() const { return hot_; }
+    std::vector<PackedEvent> &hot() { return hot_; }
+    const std::vector<EventColdFields> &cold() const { return cold_; }
+    const std::vector<uint64_t> &tokens() const { return tokens_; } // first-seen order
+
+    // Bulk load of already packed data (e.g. from a capture file). The
+    // records index tokens directly, so a table with more than MAX_TOKENS
+    // entries or a repeated token is refused and the store left empty.
+    bool assign(const uint64_t *tokens, size_t token_count, const PackedEvent *hot, size_t count,
+                const EventColdFields *cold, size_t cold_count);
+
+private:
+    uint32_t intern(uint64_t token);
+
+    std::vector<PackedEvent> hot_;
+    std::vector<EventColdFields> cold_;
+    std::vector<uint64_t> tokens_;
+    std::unordered_map<uint64_t, uint32_t> token_index_;
+    uint64_t last_token_ = 0; // consecutive events mostly share a token
+    uint32_t last_index_ = UINT32_MAX;
+};
+
+#endif // EVENTSTORE_H
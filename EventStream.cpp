@@ -0,0 +1,164 @@
+#include "EventStream.h"
+#include "Utils.h"
+#include <cstring>
+
+LineReader::LineReader(size_t buffer_bytes) : buffer_(buffer_bytes > 0 ? buffer_bytes : 1) {}
+
+LineReader::~LineReader()
+{
+    if (file_)
+        std::fclose(file_);
+}
+
+bool LineReader::open(const std::string &path)
+{
+    file_ = std::fopen(path.c_str(), "rb");
+    return file_ != nullptr;
+}
+
+// Moves the unread tail to the front and reads more behind it, doubling
+// the buffer only when a single line does not fit
+bool LineReader::refill()
+{
+    if (eof_)
+        return false;
+    if (begin_ > 0)
+    {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    if (end_ == buffer_.size())
+        buffer_.resize(buffer_.size() * 2);
+    size_t n = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+    if (n == 0)
+        eof_ = true;
+    end_ += n;
+    return n > 0;
+}
+
+bool LineReader::next(std::string_view &line)
+{
+    if (!file_)
+        return false;
+    size_t scanned = begin_;
+    for (;;)
+    {
+        const char *base = buffer_.data();
+        const char *nl = static_cast<const char *>(std::memchr(base + scanned, '\n', end_ - scanned));
+        if (nl || (eof_ && end_ > begin_))
+        {
+            size_t line_end = nl ? nl - base : end_;
+            size_t len = line_end - begin_;
+            if (len > 0 && base[begin_ + len - 1] == '\r')
+                --len;
+            line = std::string_view(base + begin_, len);
+            begin_ = nl ? line_end + 1 : end_;
+            ++line_no_;
+            return true;
+        }
+        if (eof_)
+            return false;
+        size_t offset = end_ - begin_;
+        refill();
+        scanned = begin_ + offset;
+    }
+}
+
+EventStream::EventStream(const std::vector<CsvSource> &sources, uint64_t reorder_window_ns) : window_(reorder_window_ns)
+{
+    for (const auto &s : sources)
+        sources_.push_back(std::make_unique<Source>(s));
+}
+
+bool EventStream::open(std::string &error)
+{
+    for (auto &s : sources_)
+    {
+        std::string_view header;
+        if (!s->reader.open(s->csv.path))
+        {
+            error = s->csv.path;
+            return false;
+        }
+        s->done = !s->reader.next(header);
+    }
+    return true;
+}
+
+bool EventStream::read_one(size_t s)
+{
+    Source &src = *sources_[s];
+    std::string_view line;
+    while (src.reader.next(line))
+    {
+        if (line.empty())
+            continue;
+        ++stats_.rows;
+        Event event;
+        Utils::ParseStatus status = Utils::parse_event(line, src.csv.is_trade_file, event);
+        if (status != Utils::ParseStatus::OK)
+        {
+            const char *reason = "corrupt line: ";
+            if (status == Utils::ParseStatus::CORRUPT)
+                ++stats_.corrupt;
+            else
+            {
+                ++stats_.unknown_type;
+                reason = "unknown order type: ";
+            }
+            if (stats_.samples.size() < IngestStats::MAX_SAMPLES)
+                stats_.samples.push_back(src.csv.path + ":" + std::to_string(src.reader.line_number()) + ": " + reason + std::string(line));
+            continue;
+        }
+        if (event.timestamp == 0)
+            continue;
+        ++stats_.events;
+        if (event.timestamp > src.watermark)
+            src.watermark = event.timestamp;
+        pending_.push({event.timestamp, s, src.reader.line_number(), event});
+        if (pending_.size() > peak_buffered_)
+            peak_buffered_ = pending_.size();
+        return true;
+    }
+    src.done = true;
+    return false;
+}
+
+// The head is safe once every unfinished source has read strictly past
+// head + window, so no row that sorts before it (ties included) can follow
+bool EventStream::can_emit() const
+{
+    if (pending_.empty())
+        return false;
+    uint64_t head = pending_.top().timestamp;
+    uint64_t horizon = (head > UINT64_MAX - window_) ? UINT64_MAX : head + window_;
+    for (const auto &s : sources_)
+        if (!s->done && s->watermark <= horizon)
+            return false;
+    return true;
+}
+
+bool EventStream::next(Event &event)
+{
+    while (!can_emit())
+    {
+        // Advance the unfinished source that lags furthest behind
+        size_t lagging = sources_.size();
+        for (size_t s = 0; s < sources_.size(); ++s)
+            if (!sources_[s]->done && (lagging == sources_.size() || sources_[s]->watermark < sources_[lagging]->watermark))
+                lagging = s;
+        if (lagging == sources_.size())
+            break; // Every source drained: flush what is left
+        read_one(lagging);
+    }
+    if (pending_.empty())
+        return false;
+    event = pending_.top().event;
+    pending_.pop();
+    if (event.timestamp < last_emitted_)
+        ++late_events_;
+    else
+        last_emitted_ = event.timestamp;
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef EVENTSTREAM_H
+#define EVENTSTREAM_H
+
+#include "Ingest.h"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reads a text file one line at a time through a fixed-size buffer
+class LineReader
+{
+public:
+    explicit LineReader(size_t buffer_bytes = 1u << 20);
+    ~LineReader();
+
+    LineReader(const LineReader &) = delete;
+    LineReader &operator=(const LineReader &) = delete;
+
+    bool open(const std::string &path);
+    // line stays valid until the next call; '\r' is stripped. False at EOF.
+    bool next(std::string_view &line);
+    size_t line_number() const { return line_no_; }
+
+private:
+    bool refill();
+
+    std::FILE *file_ = nullptr;
+    std::vector<char> buffer_;
+    size_t begin_ = 0; // unread bytes are buffer_[begin_, end_)
+    size_t end_ = 0;
+    bool eof_ = false;
+    size_t line_no_ = 0;
+};
+
+// Merges the order and trade files by timestamp while reading them
+// incrementally. Rows are held back until every unfinished source has read
+// past row.timestamp + reorder_window_ns, so rows at most that far out of
+// order within a file still come out sorted. Memory is bounded by the rows
+// inside the window, not by file size.
+class EventStream
+{
+public:
+    EventStream(const std::vector<CsvSource> &sources, uint64_t reorder_window_ns);
+
+    bool open(std::string &error); // error names the source that failed
+    bool next(Event &event);       // False once every source is drained
+
+    const IngestStats &stats() const { return stats_; }
+    uint64_t late_events() const { return late_events_; } // Emitted behind an already emitted timestamp
+    size_t peak_buffered() const { return peak_buffered_; }
+
+private:
+    struct Source
+    {
+        CsvSource csv;
+        LineReader reader;
+        uint64_t watermark = 0; // Highest timestamp read so far
+        bool done = false;
+
+        explicit Source(const CsvSource &c) : csv(c) {}
+    };
+
+    struct Pending
+    {
+        uint64_t timestamp;
+        size_t source;
+        size_t line;
+        Event event;
+
+        bool operator>(const Pending &o) const
+        {
+            if (timestamp != o.timestamp)
+                return timestamp > o.timestamp;
+            if (source != o.source)
+                return source > o.source;
+            return line > o.line;
+        }
+    };
+
+    bool read_one(size_t s); // Pulls the next valid event of source s into the heap
+    bool can_emit() const;
+
+    std::vector<std::unique_ptr<Source>> sources_;
+    uint64_t window_;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending_;
+    IngestStats stats_;
+    uint64_t last_emitted_ = 0;
+    uint64_t late_events_ = 0;
+    size_t peak_buffered_ = 0;
+};
+
+#endif // EVENTSTREAM_H
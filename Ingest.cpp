@@ -0,0 +1,288 @@
+#include "Ingest.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <queue>
+
+void IngestStats::merge(const IngestStats &other)
+{
+    rows += other.rows;
+    events += other.events;
+    corrupt += other.corrupt;
+    unknown_type += other.unknown_type;
+    for (const auto &s : other.samples)
+        if (samples.size() < MAX_SAMPLES)
+            samples.push_back(s);
+}
+
+void IngestStats::report(std::ostream &os) const
+{
+    os << "[Ingest] " << rows << " rows, " << events << " events, "
+       << corrupt << " corrupt, " << unknown_type << " unknown order type\n";
+    for (const auto &s : samples)
+        os << "[Ingest]   " << s << "\n";
+    if (corrupt + unknown_type > samples.size())
+        os << "[Ingest]   ... " << (corrupt + unknown_type - samples.size()) << " more not shown\n";
+}
+
+namespace
+{
+    // Parsed slice of one file. Rejected rows are sampled with chunk-relative
+    // line numbers, rebased once the line count of earlier chunks is known.
+    struct Chunk
+    {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        bool is_trade_file = false;
+        size_t source = 0;
+        EventStore events;
+        IngestStats stats;
+        size_t lines = 0;
+        std::vector<std::pair<size_t, std::string>> rejected; // local line, "reason: row"
+    };
+
+    void parse_chunk(Chunk &chunk)
+    {
+        const char *p = chunk.begin;
+        const char *end = chunk.end;
+        chunk.events.reserve(static_cast<size_t>(std::count(p, end, '\n')) + 1);
+        while (p < end)
+        {
+            const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            const char *line_end = nl ? nl : end;
+            ++chunk.lines;
+            size_t len = line_end - p;
+            if (len > 0 && p[len - 1] == '\r')
+                --len;
+            std::string_view line(p, len);
+            p = nl ? nl + 1 : end;
+            if (line.empty())
+                continue;
+
+            ++chunk.stats.rows;
+            Event event;
+            Utils::ParseStatus status = Utils::parse_event(line, chunk.is_trade_file, event);
+            if (status != Utils::ParseStatus::OK)
+            {
+                const char *reason = "corrupt line: ";
+                if (status == Utils::ParseStatus::CORRUPT)
+                    ++chunk.stats.corrupt;
+                else
+                {
+                    ++chunk.stats.unknown_type;
+                    reason = "unknown order type: ";
+                }
+                if (chunk.rejected.size() < IngestStats::MAX_SAMPLES)
+                    chunk.rejected.emplace_back(chunk.lines, reason + std::string(line));
+                continue;
+            }
+            if (event.timestamp > 0)
+            {
+                if (!chunk.events.push_back(event))
+                {
+                    ++chunk.stats.corrupt; // token dictionary full
+                    continue;
+                }
+                ++chunk.stats.events;
+            }
+        }
+    }
+
+    // Newline-aligned [begin, end) slices of a file body, header skipped
+    void split_chunks(const MappedFile &file, size_t source, bool is_trade_file, size_t chunk_bytes,
+                      std::vector<Chunk> &chunks)
+    {
+        const char *p = file.data();
+        const char *end = p + file.size();
+        if (!p)
+            return;
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+        while (p < end)
+        {
+            const char *cut = (static_cast<size_t>(end - p) > chunk_bytes) ? p + chunk_bytes : end;
+            if (cut < end)
+            {
+                nl = static_cast<const char *>(std::memchr(cut, '\n', end - cut));
+                cut = nl ? nl + 1 : end;
+            }
+            Chunk chunk;
+            chunk.begin = p;
+            chunk.end = cut;
+            chunk.is_trade_file = is_trade_file;
+            chunk.source = source;
+            chunks.push_back(std::move(chunk));
+            p = cut;
+        }
+    }
+}
+
+void Ingest::radix_sort_by_timestamp(EventStore &store)
+{
+    std::vector<PackedEvent> &events = store.hot();
+    size_t n = events.size();
+    auto by_time = [](const PackedEvent &a, const PackedEvent &b)
+    { return a.timestamp < b.timestamp; };
+    if (n < 2 || std::is_sorted(events.begin(), events.end(), by_time))
+        return;
+
+    // Sort (key, index) pairs rather than whole events, 16 bits per pass.
+    // Passes whose digit is identical for every key are skipped, which drops
+    // most of them since a chunk spans a narrow time range.
+    struct Key
+    {
+        uint64_t ts;
+        uint32_t idx;
+    };
+    const int BITS = 16;
+    const size_t BUCKETS = size_t(1) << BITS;
+    std::vector<Key> keys(n), scratch(n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = {events[i].timestamp, static_cast<uint32_t>(i)};
+
+    std::vector<size_t> count(BUCKETS);
+    for (int shift = 0; shift < 64; shift += BITS)
+    {
+        std::fill(count.begin(), count.end(), 0);
+        for (const Key &k : keys)
+            ++count[(k.ts >> shift) & (BUCKETS - 1)];
+        if (count[(keys[0].ts >> shift) & (BUCKETS - 1)] == n)
+            continue;
+        size_t sum = 0;
+        for (size_t b = 0; b < BUCKETS; ++b)
+        {
+            size_t c = count[b];
+            count[b] = sum;
+            sum += c;
+        }
+        for (const Key &k : keys)
+            scratch[count[(k.ts >> shift) & (BUCKETS - 1)]++] = k;
+        keys.swap(scratch);
+    }
+
+    // Gathering moves 32-byte records; cold fields stay put behind cold_index
+    std::vector<PackedEvent> sorted;
+    sorted.reserve(n);
+    for (const Key &k : keys)
+        sorted.push_back(events[k.idx]);
+    events.swap(sorted);
+}
+
+bool Ingest::load_csv(const std::string &path, bool is_trade_file, EventStore &out, IngestStats &stats)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+
+    std::vector<Chunk> chunks;
+    split_chunks(file, 0, is_trade_file, file.size() + 1, chunks);
+    size_t line_base = 1; // header
+    for (Chunk &chunk : chunks)
+    {
+        parse_chunk(chunk);
+        std::vector<uint32_t> token_map = out.adopt_tokens(chunk.events);
+        out.reserve(out.size() + chunk.events.size());
+        for (size_t i = 0; i < chunk.events.size(); ++i)
+        {
+            if (!out.append(chunk.events, i, token_map))
+            {
+                ++chunk.stats.corrupt; // token dictionary full
+                --chunk.stats.events;
+            }
+        }
+        for (const auto &r : chunk.rejected)
+            if (stats.samples.size() < IngestStats::MAX_SAMPLES)
+                stats.samples.push_back(path + ":" + std::to_string(line_base + r.first) + ": " + r.second);
+        stats.merge(chunk.stats);
+        line_base += chunk.lines;
+    }
+    return true;
+}
+
+bool Ingest::load_sorted(const std::vector<CsvSource> &sources, ThreadPool &pool, EventStore &out,
+                         IngestStats &stats, std::string &error, size_t chunk_bytes)
+{
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<Chunk> chunks;
+    for (size_t s = 0; s < sources.size(); ++s)
+    {
+        files.push_back(std::make_unique<MappedFile>());
+        if (!files.back()->open(sources[s].path))
+        {
+            error = sources[s].path;
+            return false;
+        }
+        split_chunks(*files.back(), s, sources[s].is_trade_file, chunk_bytes > 0 ? chunk_bytes : 1, chunks);
+    }
+
+    for (Chunk &chunk : chunks)
+        pool.submit([&chunk]
+                    {
+            parse_chunk(chunk);
+            radix_sort_by_timestamp(chunk.events); });
+    pool.wait_idle();
+
+    // Chunks are in (source, line) order; rebase sampled line numbers
+    size_t total = 0;
+    size_t line_base = 1;
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        if (c > 0 && chunks[c].source != chunks[c - 1].source)
+            line_base = 1;
+        for (const auto &r : chunks[c].rejected)
+            if (stats.samples.size() < IngestStats::MAX_SAMPLES)
+                stats.samples.push_back(sources[chunks[c].source].path + ":" + std::to_string(line_base + r.first) + ": " + r.second);
+        stats.merge(chunks[c].stats);
+        line_base += chunks[c].lines;
+        total += chunks[c].events.size();
+    }
+
+    // k-way merge; ties resolve to the lower chunk index, i.e. (source, line)
+    typedef std::pair<uint64_t, size_t> Head; // timestamp, chunk index
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    std::vector<size_t> pos(chunks.size(), 0);
+    std::vector<std::vector<uint32_t>> token_maps(chunks.size()); // chunk token index -> out's
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        token_maps[c] = out.adopt_tokens(chunks[c].events);
+        if (!chunks[c].events.empty())
+            heap.push({chunks[c].events.hot()[0].timestamp, c});
+    }
+
+    out.reserve(out.size() + total);
+    size_t dropped = 0; // tokens past the dictionary limit
+    while (!heap.empty())
+    {
+        size_t c = heap.top().second;
+        heap.pop();
+        const EventStore &store = chunks[c].events;
+        const std::vector<PackedEvent> &events = store.hot();
+        // Drain the run that still sorts before every other chunk head
+        uint64_t limit = heap.empty() ? UINT64_MAX : heap.top().first;
+        size_t other = heap.empty() ? SIZE_MAX : heap.top().second;
+        size_t i = pos[c];
+        do
+        {
+            if (!out.append(store, i++, token_maps[c]))
+                ++dropped;
+        } while (i < events.size() && (events[i].timestamp < limit || (events[i].timestamp == limit && c < other)));
+        pos[c] = i;
+        if (i < events.size())
+            heap.push({events[i].timestamp, c});
+        else
+            EventStore().swap(chunks[c].events); // Release drained chunk
+    }
+    if (dropped > 0)
+    {
+        stats.corrupt += dropped;
+        stats.events -= dropped;
+        if (stats.samples.size() < IngestStats::MAX_SAMPLES)
+            stats.samples.push_back(std::to_string(dropped) + " event(s) dropped: more than " +
+                                    std::to_string(PackedEvent::MAX_TOKENS) + " distinct tokens");
+    }
+    return true;
+}
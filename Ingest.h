@@ -0,0 +1,57 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "DataTypes.h"
+#include "EventStore.h"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Rejected-row accounting for a load: counts plus the first few offending
+// lines, instead of one std::cerr write per bad row
+struct IngestStats
+{
+    static constexpr size_t MAX_SAMPLES = 10;
+
+    size_t rows = 0; // data rows seen, header excluded
+    size_t events = 0;
+    size_t corrupt = 0;
+    size_t unknown_type = 0;
+    std::vector<std::string> samples; // "<file>:<line>: <reason>: <row>"
+
+    void merge(const IngestStats &other);
+    void report(std::ostream &os) const;
+};
+
+struct CsvSource
+{
+    std::string path;
+    bool is_trade_file;
+};
+
+namespace Ingest
+{
+    const size_t DEFAULT_CHUNK_BYTES = 8u << 20;
+
+    // Memory-maps a NSE order or trade CSV and appends its events to out.
+    // Rows are tokenised in place; out is grown once from a newline count.
+    // Returns false if the file cannot be opened.
+    bool load_csv(const std::string &path, bool is_trade_file, EventStore &out, IngestStats &stats);
+
+    // Loads every source into out in replay order. Each file is cut into
+    // newline-aligned chunks parsed in parallel on pool; every chunk is
+    // stable radix-sorted by timestamp, then all chunks are k-way merged.
+    // Equal timestamps keep (source index, line number) order, so the
+    // result does not depend on chunking or thread count. On failure,
+    // error names the source that could not be opened.
+    bool load_sorted(const std::vector<CsvSource> &sources, ThreadPool &pool, EventStore &out,
+                     IngestStats &stats, std::string &error, size_t chunk_bytes = DEFAULT_CHUNK_BYTES);
+
+    // Stable LSD radix sort of the store's records by timestamp
+    void radix_sort_by_timestamp(EventStore &events);
+}
+
+#endif // INGEST_H
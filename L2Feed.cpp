@@ -0,0 +1,182 @@
+#include "L2Feed.h"
+#include <cstring>
+
+namespace
+{
+    const char MAGIC[8] = {'L', 'O', 'B', 'L', '2', '\0', '\0', '\0'};
+
+    uint8_t side_byte(Side side) { return side == Side::BUY ? 0 : 1; }
+}
+
+L2FeedPublisher::L2FeedPublisher(OrderBook &book, uint64_t token, uint64_t refresh_interval)
+    : book_(book), token_(token), refresh_interval_(refresh_interval > 0 ? refresh_interval : 1),
+      events_since_refresh_(refresh_interval_)
+{
+    book_.add_listener(this, 0); // needs no level_index
+}
+
+L2FeedPublisher::~L2FeedPublisher()
+{
+    book_.remove_listener(this);
+}
+
+void L2FeedPublisher::on_level_change(const LevelChange &change)
+{
+    for (auto &p : pending_)
+    {
+        if (p.side == change.side && p.price == change.price)
+        {
+            p.new_quantity = change.new_quantity;
+            return;
+        }
+    }
+    pending_.push_back({change.side, change.price, change.new_quantity - change.quantity_delta, change.new_quantity});
+}
+
+L2Record L2FeedPublisher::make_record(L2RecordType type, uint64_t timestamp)
+{
+    L2Record r;
+    std::memset(&r, 0, sizeof(r));
+    r.token = token_;
+    r.sequence = ++sequence_;
+    r.timestamp = timestamp;
+    r.type = type;
+    return r;
+}
+
+size_t L2FeedPublisher::publish(uint64_t timestamp, std::vector<L2Record> &out)
+{
+    size_t before = out.size();
+    if (events_since_refresh_ >= refresh_interval_)
+    {
+        // The refresh carries every pending change already
+        pending_.clear();
+        refresh(timestamp, out);
+        events_since_refresh_ = 1;
+        return out.size() - before;
+    }
+    ++events_since_refresh_;
+
+    for (const auto &p : pending_)
+    {
+        if (p.old_quantity == p.new_quantity)
+            continue; // includes a level added and removed within the event
+        L2Record r = make_record(L2RecordType::DELTA, timestamp);
+        r.side = side_byte(p.side);
+        r.price = p.price;
+        r.quantity = p.new_quantity;
+        if (p.old_quantity == 0)
+            r.flags |= L2Record::ADDED;
+        if (p.new_quantity == 0)
+            r.flags |= L2Record::REMOVED;
+        out.push_back(r);
+    }
+    pending_.clear();
+    return out.size() - before;
+}
+
+void L2FeedPublisher::refresh(uint64_t timestamp, std::vector<L2Record> &out)
+{
+    size_t n_bids = book_.level_count(Side::BUY);
+    size_t n_asks = book_.level_count(Side::SELL);
+    L2Record begin = make_record(L2RecordType::REFRESH_BEGIN, timestamp);
+    begin.price = static_cast<int32_t>(n_bids);
+    begin.quantity = static_cast<int32_t>(n_asks);
+    out.push_back(begin);
+
+    for (Side side : {Side::BUY, Side::SELL})
+    {
+        size_t n = side == Side::BUY ? n_bids : n_asks;
+        levels_.resize(n);
+        int got = side == Side::BUY ? book_.get_bids_depth(levels_.data(), static_cast<int>(n))
+                                    : book_.get_asks_depth(levels_.data(), static_cast<int>(n));
+        for (int i = 0; i < got; ++i)
+        {
+            L2Record r = make_record(L2RecordType::REFRESH_LEVEL, timestamp);
+            r.side = side_byte(side);
+            r.price = levels_[i].first;
+            r.quantity = levels_[i].second;
+            out.push_back(r);
+        }
+    }
+}
+
+bool L2BookReplica::apply(const L2Record &record)
+{
+    if (record.type == L2RecordType::REFRESH_BEGIN)
+    {
+        bids_.clear();
+        asks_.clear();
+        refresh_remaining_ = static_cast<uint64_t>(record.price) + static_cast<uint64_t>(record.quantity);
+        next_sequence_ = record.sequence + 1;
+        synced_ = refresh_remaining_ == 0;
+        return true;
+    }
+    if (next_sequence_ == 0 || record.sequence != next_sequence_)
+    {
+        // Lost records: stay out of sync until the next refresh
+        if (synced_ || refresh_remaining_ > 0)
+            ++gaps_;
+        synced_ = false;
+        refresh_remaining_ = 0;
+        next_sequence_ = 0;
+        return false;
+    }
+    ++next_sequence_;
+
+    if (record.type == L2RecordType::REFRESH_LEVEL)
+    {
+        if (record.side == 0)
+            bids_[record.price] = record.quantity;
+        else
+            asks_[record.price] = record.quantity;
+        if (refresh_remaining_ > 0 && --refresh_remaining_ == 0)
+            synced_ = true;
+        return true;
+    }
+    if (!synced_)
+        return false;
+
+    if (record.side == 0)
+    {
+        if (record.flags & L2Record::REMOVED)
+            bids_.erase(record.price);
+        else
+            bids_[record.price] = record.quantity;
+    }
+    else
+    {
+        if (record.flags & L2Record::REMOVED)
+            asks_.erase(record.price);
+        else
+            asks_[record.price] = record.quantity;
+    }
+    return true;
+}
+
+bool L2FeedWriter::open(const std::string &path, std::string &error)
+{
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    uint32_t header[2] = {VERSION, static_cast<uint32_t>(sizeof(L2Record))};
+    out_.write(MAGIC, sizeof(MAGIC));
+    out_.write(reinterpret_cast<const char *>(header), sizeof(header));
+    written_ = 0;
+    return out_.good();
+}
+
+void L2FeedWriter::write(const L2Record *records, size_t count)
+{
+    out_.write(reinterpret_cast<const char *>(records), count * sizeof(L2Record));
+    written_ += count;
+}
+
+bool L2FeedWriter::close()
+{
+    out_.close();
+    return !out_.fail();
+}
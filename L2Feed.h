@@ -0,0 +1,124 @@
+#ifndef L2FEED_H
+#define L2FEED_H
+
+#include "OrderBook.h"
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+enum class L2RecordType : uint8_t
+{
+    DELTA,         // one level's new aggregate quantity
+    REFRESH_BEGIN, // price/quantity hold the bid/ask level counts that follow
+    REFRESH_LEVEL  // one level of a full refresh, best first per side
+};
+
+// Market-by-price feed record. Sequence numbers are per token and
+// consecutive from 1, so a gap means records were lost; the receiver then
+// waits for the next REFRESH_BEGIN, which replaces its whole book.
+struct L2Record
+{
+    static constexpr uint8_t ADDED = 0x01;   // level did not exist before
+    static constexpr uint8_t REMOVED = 0x02; // level emptied; quantity is 0
+
+    uint64_t token;
+    uint64_t sequence;
+    uint64_t timestamp;
+    int32_t price;
+    int32_t quantity;
+    L2RecordType type;
+    uint8_t side; // 0 buy, 1 sell
+    uint8_t flags;
+    uint8_t reserved[5];
+};
+
+static_assert(sizeof(L2Record) == 40, "L2Record layout changed");
+
+// Turns one book's level changes into L2 records. Changes are coalesced per
+// event, so a level touched several times yields at most one delta and one
+// that appears and vanishes within the event yields none. The first publish
+// and every refresh_interval events after it emit a full refresh instead.
+class L2FeedPublisher : public BookListener
+{
+public:
+    static constexpr uint64_t DEFAULT_REFRESH_INTERVAL = 10000;
+
+    L2FeedPublisher(OrderBook &book, uint64_t token, uint64_t refresh_interval = DEFAULT_REFRESH_INTERVAL);
+    ~L2FeedPublisher();
+    L2FeedPublisher(const L2FeedPublisher &) = delete;
+    L2FeedPublisher &operator=(const L2FeedPublisher &) = delete;
+
+    void on_level_change(const LevelChange &change) override;
+
+    // Closes the current event: appends its records to out, returns how many
+    size_t publish(uint64_t timestamp, std::vector<L2Record> &out);
+    // Forces a full refresh on the next publish
+    void request_refresh() { events_since_refresh_ = refresh_interval_; }
+
+    uint64_t last_sequence() const { return sequence_; }
+
+private:
+    struct PendingLevel
+    {
+        Side side;
+        int price;
+        int old_quantity; // before the event, 0 if the level did not exist
+        int new_quantity;
+    };
+
+    L2Record make_record(L2RecordType type, uint64_t timestamp);
+    void refresh(uint64_t timestamp, std::vector<L2Record> &out);
+
+    OrderBook &book_;
+    uint64_t token_;
+    uint64_t refresh_interval_;
+    uint64_t events_since_refresh_;
+    uint64_t sequence_ = 0;
+    std::vector<PendingLevel> pending_;
+    std::vector<std::pair<int, int>> levels_; // refresh scratch
+};
+
+// Receiver side: rebuilds a book from records, dropping everything between
+// a sequence gap and the next complete refresh
+class L2BookReplica
+{
+public:
+    // Returns false when the record was not applied (out of sync)
+    bool apply(const L2Record &record);
+    bool synced() const { return synced_; }
+    uint64_t gaps() const { return gaps_; }
+
+    const std::map<int, int, std::greater<int>> &bids() const { return bids_; }
+    const std::map<int, int> &asks() const { return asks_; }
+
+private:
+    std::map<int, int, std::greater<int>> bids_; // price -> aggregate quantity
+    std::map<int, int> asks_;
+    uint64_t next_sequence_ = 0;
+    uint64_t refresh_remaining_ = 0; // levels still due in the current refresh
+    bool synced_ = false;
+    uint64_t gaps_ = 0;
+};
+
+// Feed file (.lobl2): a small header followed by raw L2Records
+class L2FeedWriter
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    bool open(const std::string &path, std::string &error);
+    void write(const L2Record *records, size_t count);
+    void write(const std::vector<L2Record> &records) { write(records.data(), records.size()); }
+    bool close();
+
+    uint64_t records_written() const { return written_; }
+
+private:
+    std::ofstream out_;
+    uint64_t written_ = 0;
+};
+
+#endif // L2FEED_H
@@ -0,0 +1,260 @@
+#include "LatencyStats.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(LOB_LATENCY_TSC) && defined(__x86_64__)
+#include <x86intrin.h>
+#define LOB_USE_TSC
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <pthread.h>
+#define LOB_HAVE_SIGWAIT
+#endif
+
+namespace
+{
+    uint64_t steady_ns()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+uint64_t LatencyClock::now()
+{
+#ifdef LOB_USE_TSC
+    return __rdtsc();
+#else
+    return steady_ns();
+#endif
+}
+
+double LatencyClock::ns_per_tick()
+{
+#ifdef LOB_USE_TSC
+    static const double ratio = []
+    {
+        uint64_t ns0 = steady_ns(), t0 = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t ns1 = steady_ns(), t1 = __rdtsc();
+        return t1 > t0 ? static_cast<double>(ns1 - ns0) / (t1 - t0) : 1.0;
+    }();
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+// --- LogHistogram ---
+
+int LogHistogram::bucket_of(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return static_cast<int>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BITS;
+    int bucket = (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t LogHistogram::bucket_upper(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return static_cast<uint64_t>(bucket);
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t lower = (static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS)) << shift;
+    return lower + ((1ULL << shift) - 1);
+}
+
+void LogHistogram::record(uint64_t value)
+{
+    bump(buckets_[bucket_of(value)], 1);
+    bump(count_, 1);
+    bump(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed))
+        max_.store(value, std::memory_order_relaxed);
+}
+
+void LogHistogram::merge(const LogHistogram &other)
+{
+    for (int i = 0; i < BUCKETS; ++i)
+        bump(buckets_[i], other.buckets_[i].load(std::memory_order_relaxed));
+    bump(count_, other.count());
+    bump(sum_, other.sum_.load(std::memory_order_relaxed));
+    if (other.max() > max())
+        max_.store(other.max(), std::memory_order_relaxed);
+}
+
+double LogHistogram::mean() const
+{
+    uint64_t n = count();
+    return n ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+uint64_t LogHistogram::percentile(double q) const
+{
+    uint64_t n = count();
+    if (n == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(bucket_upper(i), max());
+    }
+    return max();
+}
+
+// --- LatencyStats ---
+
+void LatencyStats::merge(const LatencyStats &other)
+{
+    for (int i = 0; i < EVENT_TYPES; ++i)
+        event_ticks[i].merge(other.event_ticks[i]);
+    levels_swept.merge(other.levels_swept);
+    orders_swept.merge(other.orders_swept);
+}
+
+void LatencyStats::report(std::ostream &os) const
+{
+    static const char *const NAMES[EVENT_TYPES] = {"NEW", "MODIFY", "CANCEL", "TRADE"};
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    double scale = LatencyClock::ns_per_tick();
+
+    os << "--- process_event latency (ns) ---\n"
+       << std::left << std::setw(8) << "type" << std::right << std::setw(12) << "count" << std::setw(10) << "mean"
+       << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+       << std::setw(12) << "max" << "\n";
+    os << std::fixed << std::setprecision(0);
+    for (int i = 0; i < EVENT_TYPES; ++i)
+    {
+        const LogHistogram &h = event_ticks[i];
+        if (h.count() == 0)
+            continue;
+        os << std::left << std::setw(8) << NAMES[i] << std::right << std::setw(12) << h.count()
+           << std::setw(10) << h.mean() * scale << std::setw(10) << h.percentile(0.50) * scale
+           << std::setw(10) << h.percentile(0.90) * scale << std::setw(10) << h.percentile(0.99) * scale
+           << std::setw(10) << h.percentile(0.999) * scale << std::setw(12) << h.max() * scale << "\n";
+    }
+    os << "--- match depth per matching order ---\n";
+    const LogHistogram *sweeps[2] = {&levels_swept, &orders_swept};
+    const char *sweep_names[2] = {"levels", "orders"};
+    for (int i = 0; i < 2; ++i)
+    {
+        const LogHistogram &h = *sweeps[i];
+        os << std::left << std::setw(8) << sweep_names[i] << std::right << std::setw(12) << h.count()
+           << std::setprecision(2) << std::setw(10) << h.mean() << std::setprecision(0)
+           << std::setw(10) << h.percentile(0.50) << std::setw(10) << h.percentile(0.90)
+           << std::setw(10) << h.percentile(0.99) << std::setw(10) << h.percentile(0.999)
+           << std::setw(12) << h.max() << "\n";
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+// --- LatencyRegistry ---
+
+namespace
+{
+    std::mutex &registry_mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    std::vector<const LatencyStats *> &registry()
+    {
+        static std::vector<const LatencyStats *> stats;
+        return stats;
+    }
+}
+
+void LatencyRegistry::add(const LatencyStats *stats)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    registry().push_back(stats);
+}
+
+void LatencyRegistry::remove(const LatencyStats *stats)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::vector<const LatencyStats *> &all = registry();
+    all.erase(std::remove(all.begin(), all.end(), stats), all.end());
+}
+
+void LatencyRegistry::dump(std::ostream &os)
+{
+    // Heap-allocated: a merged LatencyStats is several tens of KB
+    std::unique_ptr<LatencyStats> merged(new LatencyStats());
+    size_t books = 0;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (const LatencyStats *stats : registry())
+            merged->merge(*stats);
+        books = registry().size();
+    }
+    os << "\n=== Latency summary across " << books << " book(s) ===\n";
+    merged->report(os);
+}
+
+// --- LatencySignalDump ---
+
+#ifdef LOB_HAVE_SIGWAIT
+struct LatencySignalDump::Impl
+{
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+};
+
+void LatencySignalDump::start()
+{
+    if (impl_)
+        return;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    impl_ = new Impl();
+    Impl *impl = impl_;
+    impl_->thread = std::thread([impl, set]
+                                {
+        while (true)
+        {
+            int sig = 0;
+            if (sigwait(&set, &sig) != 0)
+                continue;
+            if (impl->stopping.load())
+                return;
+            LatencyRegistry::dump(std::cerr);
+        } });
+}
+
+void LatencySignalDump::stop()
+{
+    if (!impl_)
+        return;
+    impl_->stopping.store(true);
+    pthread_kill(impl_->thread.native_handle(), SIGUSR1);
+    impl_->thread.join();
+    delete impl_;
+    impl_ = nullptr;
+}
+#else
+struct LatencySignalDump::Impl
+{
+};
+
+void LatencySignalDump::start() {}
+void LatencySignalDump::stop() {}
+#endif
@@ -0,0 +1,97 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include "DataTypes.h"
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Opt-in instrumentation (cmake -DLOB_LATENCY_STATS=ON). Without the option
+// OrderBook carries no timing code at all; these types still compile.
+
+// Timestamps for latency measurement: the TSC when built with
+// LOB_LATENCY_TSC on x86-64, steady_clock nanoseconds otherwise
+namespace LatencyClock
+{
+    uint64_t now();
+    double ns_per_tick(); // calibrated once against steady_clock for the TSC
+}
+
+// HDR-style histogram: each power of two is split into SUB_BUCKETS linear
+// buckets, so any recorded value is known to within 1/SUB_BUCKETS (~6%).
+// One thread records; counters are relaxed atomics written with plain
+// load/store, so another thread can read a consistent-enough view at any
+// time without slowing the writer down.
+class LogHistogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int OCTAVES = 48;
+    static constexpr int BUCKETS = (OCTAVES + 1) * SUB_BUCKETS;
+
+    void record(uint64_t value);
+    void merge(const LogHistogram &other); // this side must not be recording concurrently
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    uint64_t percentile(double q) const; // upper bound of the bucket holding quantile q
+
+private:
+    static int bucket_of(uint64_t value);
+    static uint64_t bucket_upper(int bucket);
+    static void bump(std::atomic<uint64_t> &counter, uint64_t by)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// One book's instrumentation: process_event latency per EventType (in
+// LatencyClock ticks) and how far each matching add swept the book
+struct LatencyStats
+{
+    static constexpr int EVENT_TYPES = 4;
+
+    LogHistogram event_ticks[EVENT_TYPES];
+    LogHistogram levels_swept; // price levels traded through, per matching order
+    LogHistogram orders_swept; // resting orders filled, per matching order
+
+    void merge(const LatencyStats &other);
+    void report(std::ostream &os) const;
+};
+
+// Every live book's stats, so a dump can merge them from any thread
+class LatencyRegistry
+{
+public:
+    static void add(const LatencyStats *stats);
+    static void remove(const LatencyStats *stats);
+    static void dump(std::ostream &os);
+};
+
+// Dumps the registry to stderr whenever the process receives SIGUSR1 (POSIX
+// only). start() must run before other threads are created so they all
+// inherit the blocked signal and it is delivered to the dump thread.
+class LatencySignalDump
+{
+public:
+    LatencySignalDump() = default;
+    ~LatencySignalDump() { stop(); }
+    LatencySignalDump(const LatencySignalDump &) = delete;
+    LatencySignalDump &operator=(const LatencySignalDump &) = delete;
+
+    void start();
+    void stop();
+
+private:
+    struct Impl;
+    Impl *impl_ = nullptr;
+};
+
+#endif // LATENCYSTATS_H
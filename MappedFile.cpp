@@ -0,0 +1,78 @@
+#include "MappedFile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOB_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+#ifdef LOB_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0)
+    {
+        ::close(fd);
+        opened_empty_ = true;
+        return true;
+    }
+    void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        size_ = 0;
+        return false;
+    }
+    madvise(p, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(p);
+    mapped_ = true;
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open())
+        return false;
+    size_ = static_cast<size_t>(in.tellg());
+    if (size_ == 0)
+    {
+        opened_empty_ = true;
+        return true;
+    }
+    buffer_.resize(size_);
+    in.seekg(0);
+    in.read(buffer_.data(), static_cast<std::streamsize>(size_));
+    data_ = buffer_.data();
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef LOB_HAVE_MMAP
+    if (mapped_ && data_)
+        munmap(const_cast<char *>(data_), size_);
+#endif
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    opened_empty_ = false;
+}
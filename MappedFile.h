@@ -0,0 +1,35 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available and falls back
+// to a single bulk read elsewhere; either way the bytes stay put until the
+// object is destroyed.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool is_open() const { return data_ != nullptr || opened_empty_; }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    bool opened_empty_ = false;
+    std::vector<char> buffer_; // fallback storage when mmap is unavailable
+};
+
+#endif // MAPPEDFILE_H
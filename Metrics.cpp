@@ -1,39 +1,76 @@
 #include "Metrics.h"
 #include "Utils.h"
+#include <algorithm>
 #include <cmath>
 
 // No structured bindings; support for C++11+
-LOBMetrics MetricsCalculator::calculate(const OrderBook &book, uint64_t raw_timestamp, int depth_levels, double decay_lambda)
+LOBMetrics MetricsCalculator::calculate(const OrderBook &book, uint64_t raw_timestamp, int depth_levels, double decay_lambda,
+                                        bool format_timestamp)
 {
     LOBMetrics metrics;
     metrics.timestamp_raw = raw_timestamp;
-    metrics.timestamp_formatted = Utils::format_timestamp_ist(raw_timestamp);
+    if (format_timestamp)
+    {
+        // One cached formatter per thread: BookManager workers call this concurrently
+        thread_local Utils::TimestampFormatter formatter;
+        formatter.format(raw_timestamp, metrics.timestamp_formatted);
+    }
 
     std::pair<int, int> best = book.get_best_bid_ask();
-    int best_bid = best.first;
-    int best_ask = best.second;
+    fill_top(metrics, best.first, best.second);
+
+    // --- Collect levels (stack buffers; levels past MAX_DEPTH_LEVELS read as empty) ---
+    std::pair<int, int> bid_levels[MAX_DEPTH_LEVELS];
+    std::pair<int, int> ask_levels[MAX_DEPTH_LEVELS];
+    int fetch = depth_levels < MAX_DEPTH_LEVELS ? depth_levels : MAX_DEPTH_LEVELS;
+    int n_bids = book.get_bids_depth(bid_levels, fetch);
+    int n_asks = book.get_asks_depth(ask_levels, fetch);
+    metrics.depth_bids.resize(depth_levels, 0.0);
+    metrics.depth_asks.resize(depth_levels, 0.0);
+
+    for (int i = 0; i < n_bids; ++i)
+        metrics.depth_bids[i] = static_cast<double>(bid_levels[i].second);
+    for (int i = 0; i < n_asks; ++i)
+        metrics.depth_asks[i] = static_cast<double>(ask_levels[i].second);
+
+    fill_ofi(metrics, n_bids, n_asks, depth_levels, decay_lambda);
+
+    return metrics;
+}
 
+void MetricsCalculator::calculate_from_depth(LOBMetrics &metrics, int best_bid, int best_ask, const int *bid_qty, int n_bids,
+                                             const int *ask_qty, int n_asks, int depth_levels, double decay_lambda)
+{
+    fill_top(metrics, best_bid, best_ask);
+    metrics.depth_bids.assign(depth_levels, 0.0);
+    metrics.depth_asks.assign(depth_levels, 0.0);
+    for (int i = 0; i < n_bids; ++i)
+        metrics.depth_bids[i] = static_cast<double>(bid_qty[i]);
+    for (int i = 0; i < n_asks; ++i)
+        metrics.depth_asks[i] = static_cast<double>(ask_qty[i]);
+    fill_ofi(metrics, n_bids, n_asks, depth_levels, decay_lambda);
+}
+
+void MetricsCalculator::fill_top(LOBMetrics &metrics, int best_bid, int best_ask)
+{
     // --- Classic metrics ---
+    metrics.spread = 0;
+    metrics.mid_price = 0.0;
     if (best_bid > 0 && best_ask > 0)
     {
         metrics.spread = best_ask - best_bid;
         metrics.mid_price = (static_cast<double>(best_bid) + best_ask) / 2.0;
     }
+}
 
-    // --- Collect levels ---
-    std::vector<std::pair<int, int>> bid_levels = book.get_bids_depth(depth_levels);
-    std::vector<std::pair<int, int>> ask_levels = book.get_asks_depth(depth_levels);
-    metrics.depth_bids.resize(depth_levels, 0.0);
-    metrics.depth_asks.resize(depth_levels, 0.0);
-
-    for (size_t i = 0; i < bid_levels.size(); ++i)
-        metrics.depth_bids[i] = static_cast<double>(bid_levels[i].second);
-    for (size_t i = 0; i < ask_levels.size(); ++i)
-        metrics.depth_asks[i] = static_cast<double>(ask_levels[i].second);
-
+// Both OFI terms from depth_bids/depth_asks, which hold n_bids/n_asks levels
+void MetricsCalculator::fill_ofi(LOBMetrics &metrics, int n_bids, int n_asks, int depth_levels, double decay_lambda)
+{
+    metrics.ofi_top = 0.0;
+    metrics.ofi_depth = 0.0;
     // --- Top-level OFI (classic) ---
-    double vol_bid = (bid_levels.empty() ? 0.0 : metrics.depth_bids[0]);
-    double vol_ask = (ask_levels.empty() ? 0.0 : metrics.depth_asks[0]);
+    double vol_bid = (n_bids == 0 ? 0.0 : metrics.depth_bids[0]);
+    double vol_ask = (n_asks == 0 ? 0.0 : metrics.depth_asks[0]);
     if (vol_bid + vol_ask > 0)
         metrics.ofi_top = (vol_bid - vol_ask) / (vol_bid + vol_ask);
 
@@ -52,6 +89,80 @@ LOBMetrics MetricsCalculator::calculate(const OrderBook &book, uint64_t raw_time
     }
     if (weight_sum > 0)
         metrics.ofi_depth = (weighted_bid - weighted_ask) / weight_sum;
+}
 
-    return metrics;
+IncrementalMetricsCalculator::IncrementalMetricsCalculator(OrderBook &book, int depth_levels, double decay_lambda)
+    : book_(book), depth_levels_(depth_levels), decay_lambda_(decay_lambda),
+      fetch_(depth_levels < MetricsCalculator::MAX_DEPTH_LEVELS ? depth_levels : MetricsCalculator::MAX_DEPTH_LEVELS)
+{
+    if (fetch_ < 0)
+        fetch_ = 0;
+    row_.depth_bids.resize(depth_levels_ > 0 ? depth_levels_ : 0, 0.0);
+    row_.depth_asks.resize(depth_levels_ > 0 ? depth_levels_ : 0, 0.0);
+    // The best level is always tracked so mid and spread follow it
+    book_.add_listener(this, fetch_ > 0 ? fetch_ : 1);
+}
+
+IncrementalMetricsCalculator::~IncrementalMetricsCalculator()
+{
+    book_.remove_listener(this);
+}
+
+void IncrementalMetricsCalculator::on_level_change(const LevelChange &change)
+{
+    // Other listeners may track deeper than this calculator does
+    if (change.level_index < 0 || change.level_index >= (fetch_ > 0 ? fetch_ : 1))
+        return;
+    SideCache &cache = change.side == Side::BUY ? bids_ : asks_;
+    cache.dirty = true;
+    if (cache.refetch)
+        return;
+    if (change.added || change.removed || fetch_ == 0)
+    {
+        cache.refetch = true;
+        return;
+    }
+    std::vector<double> &depth = change.side == Side::BUY ? row_.depth_bids : row_.depth_asks;
+    depth[change.level_index] += change.quantity_delta;
+}
+
+void IncrementalMetricsCalculator::refresh(Side side)
+{
+    std::pair<int, int> levels[MetricsCalculator::MAX_DEPTH_LEVELS];
+    SideCache &cache = side == Side::BUY ? bids_ : asks_;
+    std::vector<double> &depth = side == Side::BUY ? row_.depth_bids : row_.depth_asks;
+    if (fetch_ > 0)
+    {
+        cache.count = side == Side::BUY ? book_.get_bids_depth(levels, fetch_) : book_.get_asks_depth(levels, fetch_);
+        cache.best = cache.count > 0 ? levels[0].first : 0;
+    }
+    else
+    {
+        std::pair<int, int> best = book_.get_best_bid_ask();
+        cache.best = side == Side::BUY ? best.first : best.second;
+    }
+    std::fill(depth.begin(), depth.end(), 0.0);
+    for (int i = 0; i < cache.count; ++i)
+        depth[i] = static_cast<double>(levels[i].second);
+    cache.refetch = false;
+}
+
+const LOBMetrics &IncrementalMetricsCalculator::calculate(uint64_t raw_timestamp, bool format_timestamp)
+{
+    row_.timestamp_raw = raw_timestamp;
+    row_.timestamp_formatted[0] = '\0';
+    if (format_timestamp)
+        formatter_.format(raw_timestamp, row_.timestamp_formatted);
+
+    row_.unchanged = !bids_.dirty && !asks_.dirty;
+    if (row_.unchanged)
+        return row_;
+    if (bids_.refetch)
+        refresh(Side::BUY);
+    if (asks_.refetch)
+        refresh(Side::SELL);
+    MetricsCalculator::fill_top(row_, bids_.best, asks_.best);
+    MetricsCalculator::fill_ofi(row_, bids_.count, asks_.count, depth_levels_, decay_lambda_);
+    bids_.dirty = asks_.dirty = false;
+    return row_;
 }
@@ -2,26 +2,111 @@
 #define METRICS_H
 
 #include "OrderBook.h"
+#include "Utils.h"
+#include <algorithm>
 #include <vector>
 #include <string>
 
-// Metrics struct with human-readable and raw timestamp
+// Metrics struct with human-readable and raw timestamp. timestamp_formatted
+// is left empty when formatting is deferred to the output writer.
 struct LOBMetrics
 {
     uint64_t timestamp_raw = 0;
-    std::string timestamp_formatted;
+    char timestamp_formatted[Utils::TimestampFormatter::LENGTH + 1] = {};
     double mid_price = 0.0;
     int spread = 0;
     double ofi_top = 0.0;
     double ofi_depth = 0.0;
     std::vector<double> depth_bids;
     std::vector<double> depth_asks;
+    bool unchanged = false; // nothing in the tracked depth moved since the previous row
+};
+
+// Open/high/low/close of one metric over a window
+struct Ohlc
+{
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+
+    void start(double value) { open = high = low = close = value; }
+    void add(double value)
+    {
+        high = std::max(high, value);
+        low = std::min(low, value);
+        close = value;
+    }
+};
+
+// One token's metrics aggregated over a window of exchange time, sampled
+// after every event in the window
+struct MetricsBar
+{
+    uint64_t timestamp_raw = 0; // window start
+    uint64_t token = 0;
+    uint64_t events = 0;
+    Ohlc mid_price;
+    Ohlc spread;
+    Ohlc ofi_top;
+    Ohlc ofi_depth;
 };
 
 class MetricsCalculator
 {
 public:
-    static LOBMetrics calculate(const OrderBook &book, uint64_t raw_timestamp, int depth_levels = 5, double decay_lambda = 0.5);
+    static constexpr int MAX_DEPTH_LEVELS = 64; // deepest level read from the book
+    static LOBMetrics calculate(const OrderBook &book, uint64_t raw_timestamp, int depth_levels = 5, double decay_lambda = 0.5,
+                                bool format_timestamp = true);
+    // Same metrics from depth already copied out of a book (n_* <= depth_levels
+    // quantities, best first). Reuses metrics' depth vectors; timestamps untouched.
+    static void calculate_from_depth(LOBMetrics &metrics, int best_bid, int best_ask, const int *bid_qty, int n_bids,
+                                     const int *ask_qty, int n_asks, int depth_levels = 5, double decay_lambda = 0.5);
+
+private:
+    friend class IncrementalMetricsCalculator;
+    static void fill_top(LOBMetrics &metrics, int best_bid, int best_ask);
+    static void fill_ofi(LOBMetrics &metrics, int n_bids, int n_asks, int depth_levels, double decay_lambda);
+};
+
+// Change-driven calculator bound to one book. It keeps the tracked depth of
+// each side cached from the book's level changes: a quantity change inside
+// the tracked levels is applied in place, a level appearing or vanishing
+// there re-reads that side, and anything deeper is ignored. When nothing
+// tracked moved, calculate() returns the previous row marked unchanged.
+// Results match MetricsCalculator::calculate exactly.
+class IncrementalMetricsCalculator : public BookListener
+{
+public:
+    IncrementalMetricsCalculator(OrderBook &book, int depth_levels = 5, double decay_lambda = 0.5);
+    ~IncrementalMetricsCalculator();
+    IncrementalMetricsCalculator(const IncrementalMetricsCalculator &) = delete;
+    IncrementalMetricsCalculator &operator=(const IncrementalMetricsCalculator &) = delete;
+
+    void on_level_change(const LevelChange &change) override;
+
+    // Row for the book's current state; valid until the next call
+    const LOBMetrics &calculate(uint64_t raw_timestamp, bool format_timestamp = true);
+
+private:
+    struct SideCache
+    {
+        int count = 0;       // levels currently held, at most fetch_
+        int best = 0;        // best price, 0 when the side is empty
+        bool dirty = true;   // something tracked moved since the last row
+        bool refetch = true; // levels shifted; re-read the side from the book
+    };
+
+    void refresh(Side side);
+
+    OrderBook &book_;
+    int depth_levels_;
+    double decay_lambda_;
+    int fetch_; // levels read from the book, capped at MAX_DEPTH_LEVELS
+    SideCache bids_;
+    SideCache asks_;
+    LOBMetrics row_;
+    Utils::TimestampFormatter formatter_;
 };
 
 #endif // METRICS_H
@@ -0,0 +1,95 @@
+#include "MetricsEmitter.h"
+
+MetricsEmitter::MetricsEmitter(OrderBook &book, uint64_t token, const EmitConfig &config, int depth_levels,
+                               double decay_lambda)
+    : book_(book), token_(token), config_(config), depth_levels_(depth_levels), decay_lambda_(decay_lambda)
+{
+    if (config_.bars())
+        calc_.reset(new IncrementalMetricsCalculator(book_, depth_levels_, decay_lambda_));
+}
+
+MetricsEmitter::Emitted MetricsEmitter::before_event(const Event &event)
+{
+    // A late event (earlier window than the open one) counts towards the open window
+    if (config_.mode == EmitMode::INTERVAL && window_open_ && event.timestamp / config_.interval_ns > window_)
+        return close_window();
+    return Emitted::NOTHING;
+}
+
+MetricsEmitter::Emitted MetricsEmitter::after_event(const Event &event, size_t seq)
+{
+    switch (config_.mode)
+    {
+    case EmitMode::INTERVAL:
+        if (!window_open_)
+        {
+            window_ = event.timestamp / config_.interval_ns;
+            window_open_ = true;
+            bar_.events = 0;
+        }
+        if (calc_)
+        {
+            const LOBMetrics &metrics = calc_->calculate(event.timestamp, false);
+            if (bar_.events++ == 0)
+            {
+                bar_.timestamp_raw = window_ * config_.interval_ns;
+                bar_.token = token_;
+                bar_.mid_price.start(metrics.mid_price);
+                bar_.spread.start(metrics.spread);
+                bar_.ofi_top.start(metrics.ofi_top);
+                bar_.ofi_depth.start(metrics.ofi_depth);
+            }
+            else
+            {
+                bar_.mid_price.add(metrics.mid_price);
+                bar_.spread.add(metrics.spread);
+                bar_.ofi_top.add(metrics.ofi_top);
+                bar_.ofi_depth.add(metrics.ofi_depth);
+            }
+        }
+        return Emitted::NOTHING;
+
+    case EmitMode::EVERY_EVENTS:
+        if ((seq + 1) % config_.every_events == 0)
+            return emit_row(event.timestamp);
+        return Emitted::NOTHING;
+
+    case EmitMode::TOP_CHANGE:
+    {
+        std::pair<int, int> bid = {0, 0}, ask = {0, 0};
+        book_.get_bids_depth(&bid, 1);
+        book_.get_asks_depth(&ask, 1);
+        if (bid == top_bid_ && ask == top_ask_)
+            return Emitted::NOTHING;
+        top_bid_ = bid;
+        top_ask_ = ask;
+        return emit_row(event.timestamp);
+    }
+
+    case EmitMode::EVERY_EVENT:
+        break;
+    }
+    return emit_row(event.timestamp);
+}
+
+MetricsEmitter::Emitted MetricsEmitter::finish()
+{
+    return window_open_ ? close_window() : Emitted::NOTHING;
+}
+
+MetricsEmitter::Emitted MetricsEmitter::close_window()
+{
+    window_open_ = false;
+    if (calc_)
+    {
+        done_bar_ = bar_;
+        return Emitted::BAR;
+    }
+    return emit_row(window_ * config_.interval_ns);
+}
+
+MetricsEmitter::Emitted MetricsEmitter::emit_row(uint64_t timestamp)
+{
+    row_ = MetricsCalculator::calculate(book_, timestamp, depth_levels_, decay_lambda_, false);
+    return Emitted::ROW;
+}
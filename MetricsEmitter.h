@@ -0,0 +1,86 @@
+#ifndef METRICSEMITTER_H
+#define METRICSEMITTER_H
+
+#include "Metrics.h"
+#include "OrderBook.h"
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+enum class EmitMode
+{
+    EVERY_EVENT,  // a row after every event
+    INTERVAL,     // one row or bar per token per interval_ns of exchange time
+    EVERY_EVENTS, // a row after every every_events-th event of a token
+    TOP_CHANGE    // a row when the best bid or ask price or size changes
+};
+
+enum class BucketAggregation
+{
+    LAST, // the book as of the window's last event
+    OHLC  // open/high/low/close of mid, spread and OFI over the window
+};
+
+struct EmitConfig
+{
+    EmitMode mode = EmitMode::EVERY_EVENT;
+    uint64_t interval_ns = 0;
+    uint64_t every_events = 1;
+    BucketAggregation aggregation = BucketAggregation::LAST;
+
+    bool sampled() const { return mode != EmitMode::EVERY_EVENT; }
+    bool bars() const { return mode == EmitMode::INTERVAL && aggregation == BucketAggregation::OHLC; }
+};
+
+// Sampled metrics output for one token. Metrics are computed only where a
+// row is due; OHLC bars need every event's values and keep a change-driven
+// calculator on the book instead. A window closes on the token's first
+// event past it, so the caller reports each event before and after it is
+// applied, and calls finish() at the end of the input. Windows without
+// events produce nothing; window rows and bars are stamped with the
+// window start, the other modes with the triggering event.
+class MetricsEmitter
+{
+public:
+    enum class Emitted
+    {
+        NOTHING,
+        ROW, // see row()
+        BAR  // see bar()
+    };
+
+    MetricsEmitter(OrderBook &book, uint64_t token, const EmitConfig &config, int depth_levels = 5,
+                   double decay_lambda = 0.5);
+
+    // The book has not applied event yet
+    Emitted before_event(const Event &event);
+    // seq is the event's index within its token, as BookManager counts it
+    Emitted after_event(const Event &event, size_t seq);
+    // Closes the open window, if any
+    Emitted finish();
+
+    const LOBMetrics &row() const { return row_; }
+    const MetricsBar &bar() const { return done_bar_; }
+
+private:
+    Emitted close_window();
+    Emitted emit_row(uint64_t timestamp);
+
+    OrderBook &book_;
+    uint64_t token_;
+    EmitConfig config_;
+    int depth_levels_;
+    double decay_lambda_;
+    std::unique_ptr<IncrementalMetricsCalculator> calc_; // OHLC only
+
+    bool window_open_ = false;
+    uint64_t window_ = 0; // timestamp / interval_ns of the open window
+    std::pair<int, int> top_bid_ = {0, 0};
+    std::pair<int, int> top_ask_ = {0, 0};
+
+    LOBMetrics row_;
+    MetricsBar bar_;
+    MetricsBar done_bar_;
+};
+
+#endif // METRICSEMITTER_H
@@ -0,0 +1,475 @@
+#include "MetricsWriter.h"
+#include <cstdlib>
+#include <cstring>
+
+#if __cplusplus >= 201703L
+#include <filesystem>
+#endif
+
+void MetricsColumns::append(const LOBMetrics &metrics, uint64_t token_id)
+{
+    timestamp_raw.push_back(metrics.timestamp_raw);
+    token.push_back(token_id);
+    mid_price.push_back(metrics.mid_price);
+    spread.push_back(metrics.spread);
+    ofi_top.push_back(metrics.ofi_top);
+    ofi_depth.push_back(metrics.ofi_depth);
+    for (int lvl = 0; lvl < LEVELS; ++lvl)
+    {
+        bid_depth[lvl].push_back(static_cast<size_t>(lvl) < metrics.depth_bids.size() ? metrics.depth_bids[lvl] : 0.0);
+        ask_depth[lvl].push_back(static_cast<size_t>(lvl) < metrics.depth_asks.size() ? metrics.depth_asks[lvl] : 0.0);
+    }
+}
+
+void MetricsColumns::clear()
+{
+    timestamp_raw.clear();
+    token.clear();
+    mid_price.clear();
+    spread.clear();
+    ofi_top.clear();
+    ofi_depth.clear();
+    for (int lvl = 0; lvl < LEVELS; ++lvl)
+    {
+        bid_depth[lvl].clear();
+        ask_depth[lvl].clear();
+    }
+}
+
+std::unique_ptr<MetricsWriter> MetricsWriter::create(OutputFormat format)
+{
+    if (format == OutputFormat::NPY)
+        return std::unique_ptr<MetricsWriter>(new NpyMetricsWriter());
+    return std::unique_ptr<MetricsWriter>(new CsvMetricsWriter());
+}
+
+// --- CSV ---
+
+bool CsvMetricsWriter::open(const std::string &path, std::string &error)
+{
+    out_.open(path);
+    if (!out_.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    out_ << "Timestamp,TimestampRaw,Token,MidPrice,Spread,OFI_Top,OFI_Depth";
+    for (int lvl = 1; lvl <= MetricsColumns::LEVELS; ++lvl)
+    {
+        out_ << ",BidLvl" << lvl << ",AskLvl" << lvl;
+    }
+    out_ << "\n";
+    return true;
+}
+
+bool CsvMetricsWriter::resume(const std::string &path, uint64_t rows, std::string &error)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+    {
+        error = "cannot open " + path + " to resume it";
+        return false;
+    }
+    // Header plus rows complete lines
+    uint64_t keep = 0;
+    std::string line;
+    for (uint64_t lines = 0; lines < rows + 1; ++lines)
+    {
+        if (!std::getline(in, line) || in.eof())
+        {
+            error = path + " holds fewer than " + std::to_string(rows) + " rows to resume after";
+            return false;
+        }
+        keep += line.size() + 1;
+    }
+    in.close();
+#if __cplusplus >= 201703L
+    std::error_code ec;
+    std::filesystem::resize_file(path, keep, ec);
+    if (ec)
+    {
+        error = "cannot truncate " + path + ": " + ec.message();
+        return false;
+    }
+#else
+    error = "resuming output needs a C++17 build";
+    return false;
+#endif
+    out_.open(path, std::ios::app);
+    if (!out_.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    return true;
+}
+
+void CsvMetricsWriter::write_row(uint64_t timestamp_raw, uint64_t token, double mid_price, int spread, double ofi_top,
+                                 double ofi_depth, const double *bids, const double *asks)
+{
+    char timestamp[Utils::TimestampFormatter::LENGTH + 1];
+    formatter_.format(timestamp_raw, timestamp);
+    out_ << timestamp << ","
+         << timestamp_raw << ","
+         << token << ","
+         << mid_price << ","
+         << spread << ","
+         << ofi_top << ","
+         << ofi_depth;
+
+    for (int lvl = 0; lvl < MetricsColumns::LEVELS; ++lvl)
+    {
+        out_ << ",";
+        out_ << bids[lvl];
+        out_ << ",";
+        out_ << asks[lvl];
+    }
+    out_ << "\n";
+}
+
+void CsvMetricsWriter::write(const LOBMetrics &metrics, uint64_t token)
+{
+    double bids[MetricsColumns::LEVELS], asks[MetricsColumns::LEVELS];
+    for (int lvl = 0; lvl < MetricsColumns::LEVELS; ++lvl)
+    {
+        bids[lvl] = static_cast<size_t>(lvl) < metrics.depth_bids.size() ? metrics.depth_bids[lvl] : 0.0;
+        asks[lvl] = static_cast<size_t>(lvl) < metrics.depth_asks.size() ? metrics.depth_asks[lvl] : 0.0;
+    }
+    write_row(metrics.timestamp_raw, token, metrics.mid_price, metrics.spread, metrics.ofi_top, metrics.ofi_depth, bids, asks);
+}
+
+void CsvMetricsWriter::write(const MetricsColumns &rows)
+{
+    double bids[MetricsColumns::LEVELS], asks[MetricsColumns::LEVELS];
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        for (int lvl = 0; lvl < MetricsColumns::LEVELS; ++lvl)
+        {
+            bids[lvl] = rows.bid_depth[lvl][i];
+            asks[lvl] = rows.ask_depth[lvl][i];
+        }
+        write_row(rows.timestamp_raw[i], rows.token[i], rows.mid_price[i], rows.spread[i], rows.ofi_top[i], rows.ofi_depth[i],
+                  bids, asks);
+    }
+}
+
+bool CsvMetricsWriter::close()
+{
+    out_.close();
+    return !out_.fail();
+}
+
+// --- NPY ---
+
+namespace
+{
+    // Header is padded to a fixed size so it can be rewritten in place once
+    // the row count is known
+    const size_t NPY_HEADER_BYTES = 128;
+
+    template <typename T>
+    bool write_column(std::FILE *file, const std::vector<T> &values)
+    {
+        return values.empty() || std::fwrite(values.data(), sizeof(T), values.size(), file) == values.size();
+    }
+
+    bool write_header(std::FILE *file, const char *descr, uint64_t rows)
+    {
+        char header[NPY_HEADER_BYTES];
+        std::memset(header, ' ', sizeof(header));
+        std::memcpy(header, "\x93NUMPY\x01\x00", 8);
+        uint16_t dict_len = static_cast<uint16_t>(NPY_HEADER_BYTES - 10);
+        header[8] = static_cast<char>(dict_len & 0xff);
+        header[9] = static_cast<char>(dict_len >> 8);
+        std::string dict = std::string("{'descr': '") + descr + "', 'fortran_order': False, 'shape': (" + std::to_string(rows) + ",), }";
+        std::memcpy(header + 10, dict.data(), dict.size());
+        header[NPY_HEADER_BYTES - 1] = '\n';
+        return std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    }
+}
+
+NpyMetricsWriter::~NpyMetricsWriter()
+{
+    close();
+}
+
+void NpyMetricsWriter::define_columns()
+{
+    columns_.clear();
+    columns_.push_back({"TimestampRaw", "<u8"});
+    columns_.push_back({"Token", "<u8"});
+    columns_.push_back({"MidPrice", "<f8"});
+    columns_.push_back({"Spread", "<i4"});
+    columns_.push_back({"OFI_Top", "<f8"});
+    columns_.push_back({"OFI_Depth", "<f8"});
+    for (int lvl = 1; lvl <= MetricsColumns::LEVELS; ++lvl)
+    {
+        columns_.push_back({"BidLvl" + std::to_string(lvl), "<f8"});
+        columns_.push_back({"AskLvl" + std::to_string(lvl), "<f8"});
+    }
+}
+
+bool NpyMetricsWriter::open(const std::string &path, std::string &error)
+{
+#if __cplusplus >= 201703L
+    std::error_code ec;
+    std::filesystem::create_directories(path, ec);
+#endif
+    define_columns();
+    for (auto &col : columns_)
+    {
+        std::string file_path = path + "/" + col.name + ".npy";
+        col.file = std::fopen(file_path.c_str(), "wb");
+        if (!col.file || !write_header(col.file, col.descr, 0))
+        {
+            error = "cannot open " + file_path + " for writing";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NpyMetricsWriter::resume(const std::string &path, uint64_t rows, std::string &error)
+{
+#if __cplusplus >= 201703L
+    define_columns();
+    for (auto &col : columns_)
+    {
+        // Column data is fixed width: header, then rows items of the dtype's size ("<f8" -> 8)
+        std::string file_path = path + "/" + col.name + ".npy";
+        uint64_t keep = NPY_HEADER_BYTES + rows * std::strtoull(col.descr + 2, nullptr, 10);
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(file_path, ec);
+        if (ec || size < keep)
+        {
+            error = file_path + " holds fewer than " + std::to_string(rows) + " rows to resume after";
+            return false;
+        }
+        std::filesystem::resize_file(file_path, keep, ec);
+        col.file = ec ? nullptr : std::fopen(file_path.c_str(), "r+b");
+        if (!col.file || std::fseek(col.file, 0, SEEK_END) != 0)
+        {
+            error = "cannot reopen " + file_path + " for writing";
+            return false;
+        }
+    }
+    rows_written_ = rows;
+    return true;
+#else
+    (void)path;
+    (void)rows;
+    error = "resuming output needs a C++17 build";
+    return false;
+#endif
+}
+
+void NpyMetricsWriter::write(const LOBMetrics &metrics, uint64_t token)
+{
+    pending_.append(metrics, token);
+    if (pending_.size() >= BLOCK_ROWS)
+        flush();
+}
+
+void NpyMetricsWriter::write(const MetricsColumns &rows)
+{
+    flush();
+    append_block(rows);
+}
+
+void NpyMetricsWriter::flush()
+{
+    if (pending_.size() == 0)
+        return;
+    append_block(pending_);
+    pending_.clear();
+}
+
+// Column order matches open()
+void NpyMetricsWriter::append_block(const MetricsColumns &rows)
+{
+    if (columns_.empty() || rows.size() == 0)
+        return;
+    size_t c = 0;
+    ok_ &= write_column(columns_[c++].file, rows.timestamp_raw);
+    ok_ &= write_column(columns_[c++].file, rows.token);
+    ok_ &= write_column(columns_[c++].file, rows.mid_price);
+    ok_ &= write_column(columns_[c++].file, rows.spread);
+    ok_ &= write_column(columns_[c++].file, rows.ofi_top);
+    ok_ &= write_column(columns_[c++].file, rows.ofi_depth);
+    for (int lvl = 0; lvl < MetricsColumns::LEVELS; ++lvl)
+    {
+        ok_ &= write_column(columns_[c++].file, rows.bid_depth[lvl]);
+        ok_ &= write_column(columns_[c++].file, rows.ask_depth[lvl]);
+    }
+    rows_written_ += rows.size();
+}
+
+bool NpyMetricsWriter::close()
+{
+    if (columns_.empty())
+        return ok_;
+    flush();
+    for (auto &col : columns_)
+    {
+        if (!col.file)
+            continue;
+        ok_ &= write_header(col.file, col.descr, rows_written_);
+        ok_ &= std::fclose(col.file) == 0;
+    }
+    columns_.clear();
+    return ok_;
+}
+
+// --- Bars ---
+
+namespace
+{
+    const char *const BAR_METRICS[] = {"MidPrice", "Spread", "OFI_Top", "OFI_Depth"};
+    const char *const BAR_PARTS[] = {"Open", "High", "Low", "Close"};
+    const int BAR_OHLC_COLUMNS = 16;
+
+    // Column c (0..15) of the OHLC block, in BAR_METRICS x BAR_PARTS order
+    double bar_value(const MetricsBar &bar, int c)
+    {
+        const Ohlc *metrics[] = {&bar.mid_price, &bar.spread, &bar.ofi_top, &bar.ofi_depth};
+        const Ohlc &ohlc = *metrics[c / 4];
+        switch (c % 4)
+        {
+        case 0:
+            return ohlc.open;
+        case 1:
+            return ohlc.high;
+        case 2:
+            return ohlc.low;
+        default:
+            return ohlc.close;
+        }
+    }
+
+    std::string bar_column_name(int c)
+    {
+        return std::string(BAR_METRICS[c / 4]) + BAR_PARTS[c % 4];
+    }
+}
+
+std::unique_ptr<BarWriter> BarWriter::create(OutputFormat format)
+{
+    if (format == OutputFormat::NPY)
+        return std::unique_ptr<BarWriter>(new NpyBarWriter());
+    return std::unique_ptr<BarWriter>(new CsvBarWriter());
+}
+
+bool CsvBarWriter::open(const std::string &path, std::string &error)
+{
+    out_.open(path);
+    if (!out_.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    out_ << "Timestamp,TimestampRaw,Token,Events";
+    for (int c = 0; c < BAR_OHLC_COLUMNS; ++c)
+        out_ << "," << bar_column_name(c);
+    out_ << "\n";
+    return true;
+}
+
+void CsvBarWriter::write(const MetricsBar &bar)
+{
+    char timestamp[Utils::TimestampFormatter::LENGTH + 1];
+    formatter_.format(bar.timestamp_raw, timestamp);
+    out_ << timestamp << ","
+         << bar.timestamp_raw << ","
+         << bar.token << ","
+         << bar.events;
+    for (int c = 0; c < BAR_OHLC_COLUMNS; ++c)
+        out_ << "," << bar_value(bar, c);
+    out_ << "\n";
+}
+
+bool CsvBarWriter::close()
+{
+    out_.close();
+    return !out_.fail();
+}
+
+NpyBarWriter::~NpyBarWriter()
+{
+    close();
+}
+
+bool NpyBarWriter::open(const std::string &path, std::string &error)
+{
+#if __cplusplus >= 201703L
+    std::error_code ec;
+    std::filesystem::create_directories(path, ec);
+#endif
+    std::vector<std::string> names = {"TimestampRaw", "Token", "Events"};
+    descrs_ = {"<u8", "<u8", "<u8"};
+    for (int c = 0; c < BAR_OHLC_COLUMNS; ++c)
+    {
+        names.push_back(bar_column_name(c));
+        descrs_.push_back("<f8");
+    }
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::string file_path = path + "/" + names[i] + ".npy";
+        std::FILE *file = std::fopen(file_path.c_str(), "wb");
+        files_.push_back(file);
+        if (!file || !write_header(file, descrs_[i], 0))
+        {
+            error = "cannot open " + file_path + " for writing";
+            return false;
+        }
+    }
+    return true;
+}
+
+void NpyBarWriter::write(const MetricsBar &bar)
+{
+    pending_.push_back(bar);
+    if (pending_.size() >= BLOCK_ROWS)
+        flush();
+}
+
+// Column order matches open()
+void NpyBarWriter::flush()
+{
+    if (files_.empty() || pending_.empty())
+        return;
+    std::vector<uint64_t> ids(pending_.size());
+    for (size_t i = 0; i < pending_.size(); ++i)
+        ids[i] = pending_[i].timestamp_raw;
+    ok_ &= write_column(files_[0], ids);
+    for (size_t i = 0; i < pending_.size(); ++i)
+        ids[i] = pending_[i].token;
+    ok_ &= write_column(files_[1], ids);
+    for (size_t i = 0; i < pending_.size(); ++i)
+        ids[i] = pending_[i].events;
+    ok_ &= write_column(files_[2], ids);
+    std::vector<double> values(pending_.size());
+    for (int c = 0; c < BAR_OHLC_COLUMNS; ++c)
+    {
+        for (size_t i = 0; i < pending_.size(); ++i)
+            values[i] = bar_value(pending_[i], c);
+        ok_ &= write_column(files_[3 + c], values);
+    }
+    rows_written_ += pending_.size();
+    pending_.clear();
+}
+
+bool NpyBarWriter::close()
+{
+    if (files_.empty())
+        return ok_;
+    flush();
+    for (size_t i = 0; i < files_.size(); ++i)
+    {
+        if (!files_[i])
+            continue;
+        ok_ &= write_header(files_[i], descrs_[i], rows_written_);
+        ok_ &= std::fclose(files_[i]) == 0;
+    }
+    files_.clear();
+    return ok_;
+}
@@ -0,0 +1,159 @@
+#ifndef METRICSWRITER_H
+#define METRICSWRITER_H
+
+#include "Metrics.h"
+#include "Utils.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Metrics rows held column-wise; the in-memory form used to buffer rows
+// before they reach a writer
+struct MetricsColumns
+{
+    static constexpr int LEVELS = 5; // depth levels written per side
+
+    std::vector<uint64_t> timestamp_raw;
+    std::vector<uint64_t> token;
+    std::vector<double> mid_price;
+    std::vector<int32_t> spread;
+    std::vector<double> ofi_top;
+    std::vector<double> ofi_depth;
+    std::vector<double> bid_depth[LEVELS];
+    std::vector<double> ask_depth[LEVELS];
+
+    void append(const LOBMetrics &metrics, uint64_t token_id);
+    size_t size() const { return timestamp_raw.size(); }
+    void clear();
+};
+
+enum class OutputFormat
+{
+    CSV, // One text file, formatted rows
+    NPY  // Directory of per-column .npy arrays for numpy.memmap
+};
+
+class MetricsWriter
+{
+public:
+    virtual ~MetricsWriter() = default;
+
+    virtual bool open(const std::string &path, std::string &error) = 0;
+    // Reopens an existing output, keeps its first rows rows and appends
+    // after them; whatever followed (e.g. rows past a checkpoint) is cut
+    virtual bool resume(const std::string &path, uint64_t rows, std::string &error) = 0;
+    virtual void write(const LOBMetrics &metrics, uint64_t token) = 0;
+    virtual void write(const MetricsColumns &rows) = 0;
+    virtual bool close() = 0;
+
+    static std::unique_ptr<MetricsWriter> create(OutputFormat format);
+};
+
+// Metrics CSV with a formatted IST timestamp column
+class CsvMetricsWriter : public MetricsWriter
+{
+public:
+    bool open(const std::string &path, std::string &error) override;
+    bool resume(const std::string &path, uint64_t rows, std::string &error) override;
+    void write(const LOBMetrics &metrics, uint64_t token) override;
+    void write(const MetricsColumns &rows) override;
+    bool close() override;
+
+private:
+    void write_row(uint64_t timestamp_raw, uint64_t token, double mid_price, int spread, double ofi_top, double ofi_depth,
+                   const double *bids, const double *asks);
+
+    std::ofstream out_;
+    Utils::TimestampFormatter formatter_;
+};
+
+// One NPY (format 1.0) file per column under a directory, named after the
+// CSV columns (TimestampRaw.npy, MidPrice.npy, BidLvl1.npy, ...). Rows are
+// staged in MetricsColumns and appended in BLOCK_ROWS blocks; the fixed-size
+// headers are patched with the final length on close().
+class NpyMetricsWriter : public MetricsWriter
+{
+public:
+    static constexpr size_t BLOCK_ROWS = 1 << 16;
+
+    ~NpyMetricsWriter() override;
+
+    bool open(const std::string &path, std::string &error) override;
+    bool resume(const std::string &path, uint64_t rows, std::string &error) override;
+    void write(const LOBMetrics &metrics, uint64_t token) override;
+    void write(const MetricsColumns &rows) override;
+    bool close() override;
+
+private:
+    struct ColumnFile
+    {
+        std::string name;
+        const char *descr; // numpy dtype string, e.g. "<f8"
+        std::FILE *file = nullptr;
+    };
+
+    void define_columns();
+    void flush();
+    void append_block(const MetricsColumns &rows);
+
+    std::vector<ColumnFile> columns_;
+    MetricsColumns pending_;
+    uint64_t rows_written_ = 0;
+    bool ok_ = true;
+};
+
+// OHLC bars of mid, spread and OFI (see MetricsEmitter). Columns are
+// TimestampRaw, Token and Events, then Open/High/Low/Close of each metric:
+// MidPriceOpen, ..., OFI_DepthClose.
+class BarWriter
+{
+public:
+    virtual ~BarWriter() = default;
+
+    virtual bool open(const std::string &path, std::string &error) = 0;
+    virtual void write(const MetricsBar &bar) = 0;
+    virtual bool close() = 0;
+
+    static std::unique_ptr<BarWriter> create(OutputFormat format);
+};
+
+// Bar CSV with a formatted IST window-start column
+class CsvBarWriter : public BarWriter
+{
+public:
+    bool open(const std::string &path, std::string &error) override;
+    void write(const MetricsBar &bar) override;
+    bool close() override;
+
+private:
+    std::ofstream out_;
+    Utils::TimestampFormatter formatter_;
+};
+
+// One NPY file per bar column under a directory; same layout rules as
+// NpyMetricsWriter
+class NpyBarWriter : public BarWriter
+{
+public:
+    static constexpr size_t BLOCK_ROWS = 1 << 16;
+
+    ~NpyBarWriter() override;
+
+    bool open(const std::string &path, std::string &error) override;
+    void write(const MetricsBar &bar) override;
+    bool close() override;
+
+private:
+    void flush();
+
+    std::vector<std::FILE *> files_; // in column order
+    std::vector<const char *> descrs_;
+    std::vector<MetricsBar> pending_;
+    uint64_t rows_written_ = 0;
+    bool ok_ = true;
+};
+
+#endif // METRICSWRITER_H
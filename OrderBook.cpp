@@ -1,14 +1,52 @@
 #include "OrderBook.h"
-#include <iostream>
+#include "Diagnostics.h"
 #include <algorithm>
 
-OrderBook::OrderBook() : bids_{}, asks_{}, order_map_{}, snapshots_{} {}
+namespace
+{
+    char side_code(Side side)
+    {
+        return side == Side::BUY ? 'B' : 'S';
+    }
+}
+
+OrderBook::OrderBook(const OrderBookConfig &config)
+    : pool_(config.order_capacity), bids_{}, asks_{}, order_map_{}, user_index_{},
+      stp_policy_(config.stp_policy), stp_stats_{}, match_internally_(config.matching == MatchingMode::INTERNAL),
+      reconcile_stats_{}, snapshots_(config.snapshot_capacity, config.snapshot_depth)
+{
+#ifdef LOB_LATENCY_STATS
+    LatencyRegistry::add(&latency_);
+#endif
+}
+
+#ifdef LOB_LATENCY_STATS
+OrderBook::~OrderBook()
+{
+    LatencyRegistry::remove(&latency_);
+}
+#endif
 
 void OrderBook::process_event(const Event &event)
 {
-    if (event.type == EventType::NEW && would_self_trade(event))
+#ifdef LOB_LATENCY_STATS
+    uint64_t start = LatencyClock::now();
+    apply_event(event);
+    latency_.event_ticks[static_cast<int>(event.type)].record(LatencyClock::now() - start);
+#else
+    apply_event(event);
+#endif
+}
+
+void OrderBook::apply_event(const Event &event)
+{
+    // STP only applies when the book does its own matching
+    if (match_internally_ && event.type == EventType::NEW && stp_policy_ == StpPolicy::CANCEL_NEWEST &&
+        would_self_trade(event))
     {
-        std::cerr << "[OrderBook] Self-trade detected, order_id " << event.order_id << "; Ignored.\n";
+        ++stp_stats_.incoming_cancelled;
+        Diagnostics::record(DiagReason::SELF_TRADE_REJECTED, event.order_id, event.timestamp, event.token,
+                            event.price, event.quantity, side_code(event.side));
         return;
     }
 
@@ -33,23 +71,36 @@ void OrderBook::add_order(const Event &event)
 {
     if (event.quantity <= 0 || event.price <= 0)
     {
-        std::cerr << "[OrderBook] Invalid order: price/quantity must be > 0 (order_id="
-                  << event.order_id << ")\n";
+        Diagnostics::record(DiagReason::INVALID_ORDER, event.order_id, event.timestamp, event.token,
+                            event.price, event.quantity, side_code(event.side));
         return;
     }
     int remaining_quantity = event.quantity;
     // BUY SIDE
+    // Per-order owner checks are only needed if the user rests on the other side
+    bool user_crosses = match_internally_ && event.user_id != 0 &&
+                        user_has_resting(event.user_id, event.side == Side::BUY ? Side::SELL : Side::BUY);
+    // Match depth: levels traded through and resting orders filled
+    int levels_swept = 0, orders_swept = 0;
+    int swept_price = 0;
     if (event.side == Side::BUY)
     {
-        while (remaining_quantity > 0 && !asks_.empty() && event.price >= asks_.begin()->first)
+        while (match_internally_ && remaining_quantity > 0 && !asks_.empty() && event.price >= asks_.best_price())
         {
-            auto &ask_list = asks_.begin()->second;
-            auto &best_ask = ask_list.front();
-            if (best_ask.user_id == event.user_id && event.user_id != 0)
+            PriceLevel &level = asks_.best_level();
+            auto &best_ask = pool_[level.head].order;
+            if (user_crosses && best_ask.user_id == event.user_id)
             {
-                std::cerr << "[OrderBook] Prevented BUY self-trade on match (order_id=" << event.order_id << ")\n";
-                break;
+                if (!resolve_self_trade(event, level, remaining_quantity))
+                    break;
+                continue;
+            }
+            if (levels_swept == 0 || best_ask.price != swept_price)
+            {
+                ++levels_swept;
+                swept_price = best_ask.price;
             }
+            ++orders_swept;
             if (remaining_quantity >= best_ask.quantity)
             {
                 remaining_quantity -= best_ask.quantity;
@@ -57,31 +108,41 @@ void OrderBook::add_order(const Event &event)
             }
             else
             {
-                best_ask.quantity -= remaining_quantity;
+                pool_.reduce(level, level.head, remaining_quantity);
+                notify_level(Side::SELL, best_ask.price, -remaining_quantity);
                 remaining_quantity = 0;
             }
         }
         if (remaining_quantity > 0)
         {
             Order new_order(event.order_id, event.price, remaining_quantity, event.side, event.user_id);
-            bids_[event.price].push_back(new_order);
-            auto it = bids_[event.price].end();
-            --it;
-            order_map_[event.order_id] = {event.price, Side::BUY, it};
+            uint32_t node = pool_.allocate(new_order);
+            pool_.push_back(bids_.insert(event.price), node);
+            order_map_[event.order_id] = {event.price, Side::BUY, node};
+            ++bid_orders_;
+            index_user_order(new_order);
+            notify_level(Side::BUY, event.price, remaining_quantity);
         }
         // SELL SIDE
     }
     else if (event.side == Side::SELL)
     {
-        while (remaining_quantity > 0 && !bids_.empty() && event.price <= bids_.begin()->first)
+        while (match_internally_ && remaining_quantity > 0 && !bids_.empty() && event.price <= bids_.best_price())
         {
-            auto &bid_list = bids_.begin()->second;
-            auto &best_bid = bid_list.front();
-            if (best_bid.user_id == event.user_id && event.user_id != 0)
+            PriceLevel &level = bids_.best_level();
+            auto &best_bid = pool_[level.head].order;
+            if (user_crosses && best_bid.user_id == event.user_id)
             {
-                std::cerr << "[OrderBook] Prevented SELL self-trade on match (order_id=" << event.order_id << ")\n";
-                break;
+                if (!resolve_self_trade(event, level, remaining_quantity))
+                    break;
+                continue;
+            }
+            if (levels_swept == 0 || best_bid.price != swept_price)
+            {
+                ++levels_swept;
+                swept_price = best_bid.price;
             }
+            ++orders_swept;
             if (remaining_quantity >= best_bid.quantity)
             {
                 remaining_quantity -= best_bid.quantity;
@@ -89,28 +150,57 @@ void OrderBook::add_order(const Event &event)
             }
             else
             {
-                best_bid.quantity -= remaining_quantity;
+                pool_.reduce(level, level.head, remaining_quantity);
+                notify_level(Side::BUY, best_bid.price, -remaining_quantity);
                 remaining_quantity = 0;
             }
         }
         if (remaining_quantity > 0)
         {
             Order new_order(event.order_id, event.price, remaining_quantity, event.side, event.user_id);
-            asks_[event.price].push_back(new_order);
-            auto it = asks_[event.price].end();
-            --it;
-            order_map_[event.order_id] = {event.price, Side::SELL, it};
+            uint32_t node = pool_.allocate(new_order);
+            pool_.push_back(asks_.insert(event.price), node);
+            order_map_[event.order_id] = {event.price, Side::SELL, node};
+            ++ask_orders_;
+            index_user_order(new_order);
+            notify_level(Side::SELL, event.price, remaining_quantity);
         }
     }
     else
     {
-        std::cerr << "[OrderBook] Attempt to add order with unknown side (order_id="
-                  << event.order_id << ")\n";
+        Diagnostics::record(DiagReason::UNKNOWN_SIDE, event.order_id, event.timestamp, event.token,
+                            event.price, event.quantity);
+    }
+#ifdef LOB_LATENCY_STATS
+    if (orders_swept > 0)
+    {
+        latency_.levels_swept.record(levels_swept);
+        latency_.orders_swept.record(orders_swept);
     }
+#endif
 }
 
+// A quantity decrease at the same price (and side and owner) is applied in
+// place and keeps queue priority; anything else loses it and requeues.
 void OrderBook::modify_order(const Event &event)
 {
+    auto it = order_map_.find(event.order_id);
+    if (it != order_map_.end() && event.quantity > 0 && event.price == it->second.price &&
+        event.side == it->second.side)
+    {
+        const OrderLocation loc = it->second;
+        Order &order = pool_[loc.node].order;
+        if (event.quantity <= order.quantity && event.user_id == order.user_id)
+        {
+            int reduction = order.quantity - event.quantity;
+            if (reduction > 0)
+            {
+                pool_.reduce(loc.side == Side::BUY ? *bids_.find(loc.price) : *asks_.find(loc.price), loc.node, reduction);
+                notify_level(loc.side, loc.price, -reduction);
+            }
+            return;
+        }
+    }
     cancel_order(event.order_id);
     add_order(event);
 }
@@ -120,27 +210,79 @@ void OrderBook::cancel_order(uint64_t order_id)
     auto it = order_map_.find(order_id);
     if (it == order_map_.end())
         return;
-    const auto &loc = it->second;
+    const OrderLocation loc = it->second;
+    int quantity = pool_[loc.node].order.quantity;
+    unindex_user_order(pool_[loc.node].order);
     if (loc.side == Side::BUY)
     {
-        bids_[loc.price].erase(loc.it);
+        pool_.unlink(*bids_.find(loc.price), loc.node);
         cleanup_level(loc.price, Side::BUY);
+        --bid_orders_;
     }
     else
     {
-        asks_[loc.price].erase(loc.it);
+        pool_.unlink(*asks_.find(loc.price), loc.node);
         cleanup_level(loc.price, Side::SELL);
+        --ask_orders_;
     }
+    pool_.release(loc.node);
     order_map_.erase(it);
+    notify_level(loc.side, loc.price, -quantity);
 }
 
-void OrderBook::process_trade(const Event &) {}
+// Trade-driven mode: the exchange's execution fills both named orders. Id 0
+// means the feed did not name that side.
+void OrderBook::process_trade(const Event &event)
+{
+    if (match_internally_ || event.quantity <= 0)
+        return;
+    if (event.buy_order_id == 0 && event.sell_order_id == 0)
+    {
+        ++reconcile_stats_.anonymous_trades;
+        return;
+    }
+    bool buy_filled = fill_resting(event.buy_order_id, event.quantity);
+    bool sell_filled = fill_resting(event.sell_order_id, event.quantity);
+    if (buy_filled || sell_filled)
+        ++reconcile_stats_.trades;
+    else
+        ++reconcile_stats_.unmatched_trades;
+}
+
+bool OrderBook::fill_resting(uint64_t order_id, int quantity)
+{
+    if (order_id == 0)
+        return false;
+    auto it = order_map_.find(order_id);
+    if (it == order_map_.end())
+    {
+        ++reconcile_stats_.unknown_order;
+        return false;
+    }
+    ++reconcile_stats_.fills;
+    const OrderLocation loc = it->second;
+    int resting = pool_[loc.node].order.quantity;
+    if (quantity < resting)
+    {
+        pool_.reduce(loc.side == Side::BUY ? *bids_.find(loc.price) : *asks_.find(loc.price), loc.node, quantity);
+        notify_level(loc.side, loc.price, -quantity);
+        return true;
+    }
+    if (quantity > resting)
+    {
+        ++reconcile_stats_.overfills;
+        reconcile_stats_.overfill_quantity += quantity - resting;
+    }
+    ++reconcile_stats_.orders_filled;
+    cancel_order(order_id);
+    return true;
+}
 
 void OrderBook::cleanup_level(int price, Side side)
 {
-    if (side == Side::BUY && bids_[price].empty())
+    if (side == Side::BUY && bids_.find(price)->empty())
         bids_.erase(price);
-    if (side == Side::SELL && asks_[price].empty())
+    if (side == Side::SELL && asks_.find(price)->empty())
         asks_.erase(price);
 }
 
@@ -148,96 +290,81 @@ std::pair<int, int> OrderBook::get_best_bid_ask() const
 {
     int best_bid = 0, best_ask = 0;
     if (!bids_.empty())
-        best_bid = bids_.begin()->first;
+        best_bid = bids_.best_price();
     if (!asks_.empty())
-        best_ask = asks_.begin()->first;
+        best_ask = asks_.best_price();
     return std::make_pair(best_bid, best_ask);
 }
 
 int OrderBook::get_volume_at_price(int price, Side side) const
 {
-    int total = 0;
-    if (side == Side::BUY)
-    {
-        auto it = bids_.find(price);
-        if (it != bids_.end())
-            for (const auto &o : it->second)
-                total += o.quantity;
-    }
-    else
-    {
-        auto it = asks_.find(price);
-        if (it != asks_.end())
-            for (const auto &o : it->second)
-                total += o.quantity;
-    }
-    return total;
+    const PriceLevel *level = (side == Side::BUY) ? bids_.find(price) : asks_.find(price);
+    return level ? level->total_quantity : 0;
 }
 
 std::vector<std::pair<int, int>> OrderBook::get_bids_depth(int levels) const
 {
-    std::vector<std::pair<int, int>> out;
-    out.reserve(levels);
-    auto it = bids_.begin();
-    for (int lvl = 0; it != bids_.end() && lvl < levels; ++it, ++lvl)
-    {
-        int qty = 0;
-        for (auto o = it->second.begin(); o != it->second.end(); ++o)
-            qty += o->quantity;
-        out.push_back({it->first, qty});
-    }
+    std::vector<std::pair<int, int>> out(levels > 0 ? levels : 0);
+    out.resize(get_bids_depth(out.data(), levels));
     return out;
 }
 
 std::vector<std::pair<int, int>> OrderBook::get_asks_depth(int levels) const
 {
-    std::vector<std::pair<int, int>> out;
-    out.reserve(levels);
-    auto it = asks_.begin();
-    for (int lvl = 0; it != asks_.end() && lvl < levels; ++it, ++lvl)
-    {
-        int qty = 0;
-        for (auto o = it->second.begin(); o != it->second.end(); ++o)
-            qty += o->quantity;
-        out.push_back({it->first, qty});
-    }
+    std::vector<std::pair<int, int>> out(levels > 0 ? levels : 0);
+    out.resize(get_asks_depth(out.data(), levels));
     return out;
 }
 
+template <typename Ladder>
+int OrderBook::copy_depth(const Ladder &ladder, std::pair<int, int> *out, int levels)
+{
+    int n = 0;
+    if (levels <= 0)
+        return 0;
+    ladder.visit([&](int price, const PriceLevel &level)
+                 {
+        out[n++] = {price, level.total_quantity};
+        return n < levels; });
+    return n;
+}
+
+int OrderBook::get_bids_depth(std::pair<int, int> *out, int levels) const
+{
+    return copy_depth(bids_, out, levels);
+}
+
+int OrderBook::get_asks_depth(std::pair<int, int> *out, int levels) const
+{
+    return copy_depth(asks_, out, levels);
+}
+
 size_t OrderBook::order_count(Side side) const
 {
-    size_t count = 0;
-    if (side == Side::BUY)
-    {
-        for (auto it = bids_.begin(); it != bids_.end(); ++it)
-            count += it->second.size();
-    }
-    else
-    {
-        for (auto it = asks_.begin(); it != asks_.end(); ++it)
-            count += it->second.size();
-    }
-    return count;
+    return side == Side::BUY ? bid_orders_ : ask_orders_;
+}
+
+size_t OrderBook::level_count(Side side) const
+{
+    return side == Side::BUY ? bids_.size() : asks_.size();
 }
 
+// Writes straight into the ring's preallocated slot; no allocation
 void OrderBook::take_snapshot(uint64_t timestamp)
 {
-    OrderBookSnapshot snap;
-    snap.timestamp = timestamp;
-    snap.bid_levels = get_bids_depth(10);
-    snap.ask_levels = get_asks_depth(10);
-    snapshots_.push_back(snap);
-    expire_old_snapshots(MAX_SNAPSHOTS);
+    std::pair<int, int> *bids, *asks;
+    if (!snapshots_.begin_push(timestamp, bids, asks))
+        return;
+    int depth = snapshots_.depth();
+    snapshots_.commit(get_bids_depth(bids, depth), get_asks_depth(asks, depth));
 }
 
 void OrderBook::expire_old_snapshots(size_t max_snapshot_count)
 {
-    while (snapshots_.size() > max_snapshot_count)
-    {
-        snapshots_.pop_front();
-    }
+    snapshots_.trim(max_snapshot_count);
 }
-const std::deque<OrderBookSnapshot> &OrderBook::get_snapshots() const
+
+const SnapshotRing &OrderBook::get_snapshots() const
 {
     return snapshots_;
 }
@@ -246,33 +373,285 @@ bool OrderBook::would_self_trade(const Event &event) const
 {
     if (event.user_id == 0)
         return false;
+    auto it = user_index_.find(event.user_id);
+    if (it == user_index_.end())
+        return false;
+    // Crossable own orders exist iff the user's best opposite price is marketable
     if (event.side == Side::BUY)
+        return !it->second.asks.empty() && event.price >= it->second.asks.begin()->first;
+    else if (event.side == Side::SELL)
+        return !it->second.bids.empty() && event.price <= it->second.bids.rbegin()->first;
+    return false;
+}
+
+// Applies the STP policy to the resting order at the head of level, which
+// belongs to the incoming order's user. Returns whether matching continues.
+bool OrderBook::resolve_self_trade(const Event &event, PriceLevel &level, int &remaining_quantity)
+{
+    Order &resting = pool_[level.head].order;
+    switch (stp_policy_)
     {
-        for (auto it = asks_.begin(); it != asks_.end(); ++it)
+    case StpPolicy::CANCEL_OLDEST:
+        ++stp_stats_.resting_cancelled;
+        cancel_order(resting.order_id);
+        return true;
+    case StpPolicy::DECREMENT:
+        ++stp_stats_.decremented;
+        if (remaining_quantity >= resting.quantity)
         {
-            if (event.price >= it->first)
-            {
-                for (auto ot = it->second.begin(); ot != it->second.end(); ++ot)
-                    if (ot->user_id == event.user_id)
-                        return true;
-            }
-            else
-                break;
+            remaining_quantity -= resting.quantity;
+            cancel_order(resting.order_id);
         }
+        else
+        {
+            pool_.reduce(level, level.head, remaining_quantity);
+            notify_level(resting.side, resting.price, -remaining_quantity);
+            remaining_quantity = 0;
+        }
+        return true;
+    case StpPolicy::CANCEL_NEWEST:
+    default:
+        ++stp_stats_.incoming_cancelled;
+        Diagnostics::record(DiagReason::SELF_TRADE_ON_MATCH, event.order_id, event.timestamp, event.token,
+                            event.price, remaining_quantity, side_code(event.side));
+        remaining_quantity = 0;
+        return false;
     }
-    else if (event.side == Side::SELL)
+}
+
+void OrderBook::index_user_order(const Order &order)
+{
+    if (order.user_id == 0)
+        return;
+    UserOrders &u = user_index_[order.user_id];
+    ++(order.side == Side::BUY ? u.bids : u.asks)[order.price];
+}
+
+void OrderBook::unindex_user_order(const Order &order)
+{
+    if (order.user_id == 0)
+        return;
+    auto it = user_index_.find(order.user_id);
+    if (it == user_index_.end())
+        return;
+    std::map<int, uint32_t> &prices = (order.side == Side::BUY) ? it->second.bids : it->second.asks;
+    auto pit = prices.find(order.price);
+    if (pit != prices.end() && --pit->second == 0)
+        prices.erase(pit);
+    // Drop users with nothing resting so the index tracks live orders, not every user seen
+    if (it->second.bids.empty() && it->second.asks.empty())
+        user_index_.erase(it);
+}
+
+bool OrderBook::user_has_resting(uint64_t user_id, Side side) const
+{
+    auto it = user_index_.find(user_id);
+    if (it == user_index_.end())
+        return false;
+    return side == Side::BUY ? !it->second.bids.empty() : !it->second.asks.empty();
+}
+
+OrderPoolStats OrderBook::pool_stats() const
+{
+    return pool_.stats();
+}
+
+template <typename Ladder>
+void OrderBook::save_side(CheckpointWriter &out, const Ladder &ladder) const
+{
+    out.put(static_cast<uint32_t>(ladder.size()));
+    ladder.visit([&](int price, const PriceLevel &level)
+                 {
+        out.put(static_cast<int32_t>(price));
+        out.put(static_cast<uint32_t>(level.order_count));
+        pool_.for_each(level, [&](const Order &order)
+                       {
+            out.put(order.order_id);
+            out.put(static_cast<int32_t>(order.quantity));
+            out.put(order.user_id); });
+        return true; });
+}
+
+void OrderBook::save_state(CheckpointWriter &out) const
+{
+    save_side(out, bids_);
+    save_side(out, asks_);
+    out.put(stp_stats_);
+    out.put(reconcile_stats_);
+
+    out.put(static_cast<uint32_t>(snapshots_.size()));
+    for (const OrderBookSnapshot &snap : snapshots_)
+    {
+        out.put(snap.timestamp);
+        out.put(static_cast<int32_t>(snap.bid_count));
+        out.put(static_cast<int32_t>(snap.ask_count));
+        for (int i = 0; i < snap.bid_count; ++i)
+        {
+            out.put(static_cast<int32_t>(snap.bid_levels[i].first));
+            out.put(static_cast<int32_t>(snap.bid_levels[i].second));
+        }
+        for (int i = 0; i < snap.ask_count; ++i)
+        {
+            out.put(static_cast<int32_t>(snap.ask_levels[i].first));
+            out.put(static_cast<int32_t>(snap.ask_levels[i].second));
+        }
+    }
+}
+
+// Levels arrive best first and orders in queue order, so appending
+// reproduces time priority exactly
+bool OrderBook::load_side(CheckpointReader &in, Side side)
+{
+    uint32_t levels = 0;
+    in.get(levels);
+    for (uint32_t l = 0; l < levels && in.ok(); ++l)
     {
-        for (auto it = bids_.begin(); it != bids_.end(); ++it)
+        int32_t price = 0;
+        uint32_t count = 0;
+        in.get(price);
+        in.get(count);
+        // Same rule as add_order: no empty levels, no non-positive prices
+        if (count == 0 || price <= 0)
+            in.fail();
+        for (uint32_t i = 0; i < count && in.ok(); ++i)
         {
-            if (event.price <= it->first)
+            Order order(0, price, 0, side, 0);
+            int32_t quantity = 0;
+            in.get(order.order_id);
+            in.get(quantity);
+            in.get(order.user_id);
+            order.quantity = quantity;
+            if (!in.ok() || quantity <= 0 || order_map_.count(order.order_id))
+            {
+                in.fail();
+                break;
+            }
+            uint32_t node = pool_.allocate(order);
+            if (side == Side::BUY)
             {
-                for (auto ot = it->second.begin(); ot != it->second.end(); ++ot)
-                    if (ot->user_id == event.user_id)
-                        return true;
+                pool_.push_back(bids_.insert(price), node);
+                ++bid_orders_;
             }
             else
-                break;
+            {
+                pool_.push_back(asks_.insert(price), node);
+                ++ask_orders_;
+            }
+            order_map_[order.order_id] = {price, side, node};
+            index_user_order(order);
         }
     }
-    return false;
+    return in.ok();
+}
+
+bool OrderBook::load_state(CheckpointReader &in)
+{
+    reset_state();
+    load_side(in, Side::BUY);
+    load_side(in, Side::SELL);
+    in.get(stp_stats_);
+    in.get(reconcile_stats_);
+
+    uint32_t count = 0;
+    in.get(count);
+    for (uint32_t s = 0; s < count && in.ok(); ++s)
+    {
+        uint64_t timestamp = 0;
+        int32_t n_bids = 0, n_asks = 0;
+        in.get(timestamp);
+        in.get(n_bids);
+        in.get(n_asks);
+        if (n_bids < 0 || n_asks < 0)
+        {
+            in.fail();
+            break;
+        }
+        // A ring configured shallower than the saved one keeps the best levels
+        std::pair<int, int> *bids = nullptr, *asks = nullptr;
+        bool keep = snapshots_.begin_push(timestamp, bids, asks);
+        int depth = snapshots_.depth();
+        int32_t price = 0, quantity = 0;
+        for (int i = 0; i < n_bids && in.get(price) && in.get(quantity); ++i)
+            if (keep && i < depth)
+                bids[i] = {price, quantity};
+        for (int i = 0; i < n_asks && in.get(price) && in.get(quantity); ++i)
+            if (keep && i < depth)
+                asks[i] = {price, quantity};
+        if (keep)
+            snapshots_.commit(std::min(n_bids, depth), std::min(n_asks, depth));
+    }
+
+    if (!in.ok())
+    {
+        reset_state();
+        return false;
+    }
+    return true;
+}
+
+void OrderBook::reset_state()
+{
+    pool_.reset();
+    bids_ = PriceLadder<Side::BUY>();
+    asks_ = PriceLadder<Side::SELL>();
+    order_map_.clear();
+    user_index_.clear();
+    bid_orders_ = 0;
+    ask_orders_ = 0;
+    stp_stats_ = StpStats();
+    reconcile_stats_ = ReconcileStats();
+    snapshots_.clear();
+}
+
+void OrderBook::add_listener(BookListener *listener, int tracked_depth)
+{
+    listeners_.push_back({listener, tracked_depth});
+    tracked_depth_ = std::max(tracked_depth_, tracked_depth);
+}
+
+void OrderBook::remove_listener(BookListener *listener)
+{
+    tracked_depth_ = 0;
+    for (size_t i = 0; i < listeners_.size();)
+    {
+        if (listeners_[i].first == listener)
+        {
+            listeners_.erase(listeners_.begin() + i);
+            continue;
+        }
+        tracked_depth_ = std::max(tracked_depth_, listeners_[i].second);
+        ++i;
+    }
+}
+
+// Called after the change is applied, so a missing level means it was removed
+// and a level holding a single order at exactly quantity_delta was just added.
+void OrderBook::publish_level_change(Side side, int price, int quantity_delta)
+{
+    const PriceLevel *level = (side == Side::BUY) ? bids_.find(price) : asks_.find(price);
+    LevelChange change;
+    change.side = side;
+    change.price = price;
+    change.level_index = level_index(side, price);
+    change.quantity_delta = quantity_delta;
+    change.new_quantity = level ? level->total_quantity : 0;
+    change.removed = level == nullptr;
+    change.added = level && quantity_delta > 0 && level->order_count == 1 && level->total_quantity == quantity_delta;
+    for (const auto &entry : listeners_)
+        entry.first->on_level_change(change);
+}
+
+// Number of non-empty levels priced ahead of price, or -1 from tracked_depth_ on
+int OrderBook::level_index(Side side, int price) const
+{
+    int ahead = 0;
+    if (tracked_depth_ <= 0)
+        return -1;
+    if (side == Side::BUY)
+        bids_.visit([&](int p, const PriceLevel &)
+                    { return p > price && ++ahead < tracked_depth_; });
+    else
+        asks_.visit([&](int p, const PriceLevel &)
+                    { return p < price && ++ahead < tracked_depth_; });
+    return ahead < tracked_depth_ ? ahead : -1;
 }
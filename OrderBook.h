@@ -1,12 +1,15 @@
 #ifndef ORDERBOOK_H
 #define ORDERBOOK_H
 
+#include "Checkpoint.h"
 #include "DataTypes.h"
-#include <map>
-#include <list>
+#include "LatencyStats.h"
+#include "OrderPool.h"
+#include "PriceLadder.h"
+#include "SnapshotRing.h"
 #include <vector>
+#include <map>
 #include <unordered_map>
-#include <deque>
 #include <utility>
 #include <cstdint>
 
@@ -15,21 +18,96 @@ struct OrderLocation
 {
     int price;
     Side side;
-    std::list<Order>::iterator it;
+    uint32_t node; // index into the book's OrderPool
+};
+
+// Self-trade prevention: what happens when an incoming order from a user
+// would execute against that user's own resting order
+enum class StpPolicy
+{
+    CANCEL_NEWEST, // Reject the incoming order (remainder dropped if caught mid-match)
+    CANCEL_OLDEST, // Cancel the resting order and keep matching
+    DECREMENT      // Reduce both sides by the smaller quantity without trading
+};
+
+struct StpStats
+{
+    uint64_t incoming_cancelled = 0;
+    uint64_t resting_cancelled = 0;
+    uint64_t decremented = 0;
+};
+
+// Where executions come from
+enum class MatchingMode
+{
+    INTERNAL,    // add_order matches crossing orders itself; TRADE events are ignored
+    TRADE_DRIVEN // Orders always rest; TRADE events fill the resting orders they name
+};
+
+// Trade-driven replay: how well the exchange's trades line up with the book
+struct ReconcileStats
+{
+    uint64_t trades = 0;            // TRADE events that filled at least one resting order
+    uint64_t unmatched_trades = 0;  // TRADE events naming no resting order on either side
+    uint64_t anonymous_trades = 0;  // TRADE events without order ids (order-file 'T' rows); not applied
+    uint64_t fills = 0;             // resting orders found and reduced or removed
+    uint64_t orders_filled = 0;     // of which fully filled and removed
+    uint64_t unknown_order = 0;     // trade side naming an order id not resting in the book
+    uint64_t overfills = 0;         // trade side larger than the order's remaining quantity
+    uint64_t overfill_quantity = 0; // total quantity beyond what was resting
 };
 
-// Book snapshot for rolling buffer analytics
-struct OrderBookSnapshot
+struct OrderBookConfig
 {
-    uint64_t timestamp;
-    std::vector<std::pair<int, int>> bid_levels; // price, total qty
-    std::vector<std::pair<int, int>> ask_levels;
+    size_t order_capacity = OrderPool::DEFAULT_CAPACITY; // resting order nodes preallocated up front; grows on demand
+    StpPolicy stp_policy = StpPolicy::CANCEL_NEWEST;
+    MatchingMode matching = MatchingMode::INTERNAL;
+    size_t snapshot_capacity = 1000; // snapshots kept before the oldest is overwritten
+    int snapshot_depth = 10;         // levels per side stored in each snapshot
 };
 
+// One change to a price level's aggregate quantity, reported after the book
+// has applied it. level_index counts the non-empty levels ahead of this one
+// on its side (0 = best) and is -1 once that reaches the tracked depth.
+struct LevelChange
+{
+    Side side;
+    int price;
+    int level_index;
+    int quantity_delta;
+    int new_quantity; // aggregate after the change, 0 when the level was removed
+    bool added;       // the level did not exist before this change
+    bool removed;     // the level emptied and was dropped
+};
+
+// Receives level changes from an OrderBook it is attached to
+class BookListener
+{
+public:
+    virtual ~BookListener() {}
+    virtual void on_level_change(const LevelChange &change) = 0;
+};
+
+// Price level container; LOB_MAP_LADDER selects the std::map fallback
+#ifdef LOB_MAP_LADDER
+template <Side S>
+using PriceLadder = MapLadder<S>;
+#else
+template <Side S>
+using PriceLadder = FlatLadder<S>;
+#endif
+
 class OrderBook
 {
 public:
-    OrderBook();
+    explicit OrderBook(const OrderBookConfig &config = OrderBookConfig());
+#ifdef LOB_LATENCY_STATS
+    ~OrderBook();
+    OrderBook(const OrderBook &) = delete;
+    OrderBook &operator=(const OrderBook &) = delete;
+
+    const LatencyStats &latency_stats() const { return latency_; }
+#endif
 
     void process_event(const Event &event);
 
@@ -37,28 +115,93 @@ public:
     int get_volume_at_price(int price, Side side) const;
     std::vector<std::pair<int, int>> get_bids_depth(int levels) const;
     std::vector<std::pair<int, int>> get_asks_depth(int levels) const;
+    // Allocation-free variants: fill out[0..levels) best first, return levels written
+    int get_bids_depth(std::pair<int, int> *out, int levels) const;
+    int get_asks_depth(std::pair<int, int> *out, int levels) const;
     size_t order_count(Side side) const;
+    size_t level_count(Side side) const;
 
     void take_snapshot(uint64_t timestamp);
     void expire_old_snapshots(size_t max_snapshot_count);
-    const std::deque<OrderBookSnapshot> &get_snapshots() const;
+    const SnapshotRing &get_snapshots() const;
 
     bool would_self_trade(const Event &event) const;
+    const StpStats &stp_stats() const { return stp_stats_; }
+    const ReconcileStats &reconcile_stats() const { return reconcile_stats_; }
+
+    OrderPoolStats pool_stats() const;
+
+    // Listeners are not owned. tracked_depth bounds how many levels per side
+    // get an exact level_index; with none attached notification is one branch.
+    void add_listener(BookListener *listener, int tracked_depth);
+    void remove_listener(BookListener *listener);
+
+    // Checkpointing: every resting order in queue order per level, the STP
+    // and reconciliation counters and the snapshot ring. order_map_ and the
+    // user index are rebuilt from the orders on load. Listeners are not part
+    // of the state; attach them after load_state, which replaces everything.
+    void save_state(CheckpointWriter &out) const;
+    bool load_state(CheckpointReader &in); // false on malformed input, leaving the book empty
 
 private:
+    void apply_event(const Event &event);
     void add_order(const Event &event);
     void modify_order(const Event &event);
     void cancel_order(uint64_t order_id);
     void process_trade(const Event &event);
 
-    std::map<int, std::list<Order>, std::greater<int>> bids_;
-    std::map<int, std::list<Order>> asks_;
+    OrderPool pool_;
+    PriceLadder<Side::BUY> bids_;
+    PriceLadder<Side::SELL> asks_;
     std::unordered_map<uint64_t, OrderLocation> order_map_;
+    size_t bid_orders_ = 0;
+    size_t ask_orders_ = 0;
+
+    // Resting orders per user and side, keyed by price, for O(1) self-trade
+    // checks. Only orders with a non-zero user_id are indexed.
+    struct UserOrders
+    {
+        std::map<int, uint32_t> bids; // price -> resting order count
+        std::map<int, uint32_t> asks;
+    };
+    std::unordered_map<uint64_t, UserOrders> user_index_;
+    StpPolicy stp_policy_;
+    StpStats stp_stats_;
+    bool match_internally_;
+    ReconcileStats reconcile_stats_;
+
+    bool fill_resting(uint64_t order_id, int quantity); // false if no such order rests
+
+    void index_user_order(const Order &order);
+    void unindex_user_order(const Order &order);
+    bool user_has_resting(uint64_t user_id, Side side) const;
+    bool resolve_self_trade(const Event &event, PriceLevel &level, int &remaining_quantity);
 
-    std::deque<OrderBookSnapshot> snapshots_;
-    const size_t MAX_SNAPSHOTS = 1000;
+    SnapshotRing snapshots_;
 
     void cleanup_level(int price, Side side);
+    void reset_state();
+    template <typename Ladder>
+    void save_side(CheckpointWriter &out, const Ladder &ladder) const;
+    bool load_side(CheckpointReader &in, Side side);
+
+#ifdef LOB_LATENCY_STATS
+    LatencyStats latency_;
+#endif
+
+    std::vector<std::pair<BookListener *, int>> listeners_; // listener, its tracked depth
+    int tracked_depth_ = 0;                                  // deepest tracked depth of any listener
+
+    void notify_level(Side side, int price, int quantity_delta)
+    {
+        if (!listeners_.empty())
+            publish_level_change(side, price, quantity_delta);
+    }
+    void publish_level_change(Side side, int price, int quantity_delta);
+    int level_index(Side side, int price) const;
+
+    template <typename Ladder>
+    static int copy_depth(const Ladder &ladder, std::pair<int, int> *out, int levels);
 };
 
 #endif // ORDERBOOK_H
@@ -0,0 +1,112 @@
+#include "OrderFlow.h"
+
+OrderFlowGenerator::OrderFlowGenerator(const OrderFlowConfig &config)
+    : config_(config), rng_(config.seed),
+      kind_({config.add_ratio, config.cancel_ratio, config.modify_ratio, config.aggressive_ratio}),
+      offset_(config.price_decay > 0 && config.price_decay < 1 ? config.price_decay : 0.15),
+      quantity_(1, config.max_quantity > 0 ? config.max_quantity : 1), unit_(0.0, 1.0), mid_(config.mid_price) {}
+
+Event OrderFlowGenerator::next()
+{
+    drift();
+    switch (kind_(rng_))
+    {
+    case 1:
+        return cancel();
+    case 2:
+        return modify();
+    case 3:
+        return aggressive_add();
+    default:
+        return passive_add();
+    }
+}
+
+Event OrderFlowGenerator::passive_add()
+{
+    Side side = unit_(rng_) < 0.5 ? Side::BUY : Side::SELL;
+    int price = passive_price(side);
+    uint64_t id = next_order_id_++;
+    remember(id, price, side);
+    return make(EventType::NEW, id, price, quantity_(rng_), side);
+}
+
+// Priced through the touch; the generator does not know how much it fills,
+// so the order is not remembered as live
+Event OrderFlowGenerator::aggressive_add()
+{
+    Side side = unit_(rng_) < 0.5 ? Side::BUY : Side::SELL;
+    int reach = config_.aggressive_levels > 0 ? config_.aggressive_levels : 1;
+    int price = side == Side::BUY ? mid_ + reach : mid_ - reach;
+    return make(EventType::NEW, next_order_id_++, price, quantity_(rng_) * 2, side);
+}
+
+Event OrderFlowGenerator::cancel()
+{
+    if (live_.empty())
+        return passive_add();
+    size_t i = pick_live();
+    uint64_t id = live_[i].order_id;
+    Side side = live_[i].side;
+    forget(i);
+    return make(EventType::CANCEL, id, 0, 0, side);
+}
+
+// Keeps the side, re-draws price and quantity
+Event OrderFlowGenerator::modify()
+{
+    if (live_.empty())
+        return passive_add();
+    LiveOrder &order = live_[pick_live()];
+    order.price = passive_price(order.side);
+    return make(EventType::MODIFY, order.order_id, order.price, quantity_(rng_), order.side);
+}
+
+std::vector<Event> OrderFlowGenerator::generate(size_t count)
+{
+    std::vector<Event> events;
+    events.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        events.push_back(next());
+    return events;
+}
+
+Event OrderFlowGenerator::make(EventType type, uint64_t order_id, int price, int quantity, Side side)
+{
+    Event event(timestamp_, type, order_id, price, quantity, side);
+    event.token = config_.token;
+    timestamp_ += config_.timestamp_step;
+    return event;
+}
+
+// One tick off the mid plus a geometric offset, clamped to depth_ticks
+int OrderFlowGenerator::passive_price(Side side)
+{
+    int offset = 1 + offset_(rng_);
+    if (config_.depth_ticks > 0 && offset > config_.depth_ticks)
+        offset = config_.depth_ticks;
+    int price = side == Side::BUY ? mid_ - offset : mid_ + offset;
+    return price > 0 ? price : 1;
+}
+
+size_t OrderFlowGenerator::pick_live()
+{
+    return std::uniform_int_distribution<size_t>(0, live_.size() - 1)(rng_);
+}
+
+void OrderFlowGenerator::remember(uint64_t order_id, int price, Side side)
+{
+    live_.push_back({order_id, price, side});
+}
+
+void OrderFlowGenerator::forget(size_t index)
+{
+    live_[index] = live_.back();
+    live_.pop_back();
+}
+
+void OrderFlowGenerator::drift()
+{
+    if (config_.mid_drift > 0 && unit_(rng_) < config_.mid_drift)
+        mid_ += unit_(rng_) < 0.5 ? -1 : 1;
+}
@@ -0,0 +1,76 @@
+#ifndef ORDERFLOW_H
+#define ORDERFLOW_H
+
+#include "DataTypes.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Shape of the synthetic order flow. Ratios are relative weights of the
+// event kinds; prices are in ticks (one minor unit).
+struct OrderFlowConfig
+{
+    uint64_t seed = 42;
+    uint64_t token = 1;
+
+    double add_ratio = 0.55;        // passive orders resting behind the touch
+    double cancel_ratio = 0.30;     // cancels of a live order
+    double modify_ratio = 0.10;     // price/quantity change of a live order
+    double aggressive_ratio = 0.05; // marketable orders crossing the spread
+
+    int mid_price = 100000;     // starting mid
+    int depth_ticks = 50;       // passive prices fall within this many ticks of the mid
+    double price_decay = 0.15;  // geometric fall-off of passive prices away from the touch
+    double mid_drift = 0.01;    // chance per event that the mid moves one tick
+    int max_quantity = 100;     // passive quantities are uniform in [1, max_quantity]
+    int aggressive_levels = 3;  // aggressive orders reach this many ticks through the touch
+    uint64_t timestamp_step = 1000; // ns between consecutive events
+};
+
+// Seeded generator of NEW/CANCEL/MODIFY events for one token. It tracks the
+// orders it has sent, so cancels and modifies name orders that were live
+// from its point of view; some of those will already have been filled by
+// aggressive flow, which the book treats as a no-op cancel.
+class OrderFlowGenerator
+{
+public:
+    explicit OrderFlowGenerator(const OrderFlowConfig &config = OrderFlowConfig());
+
+    Event next();
+    Event passive_add();
+    Event aggressive_add();
+    Event cancel();   // falls back to passive_add() with nothing live
+    Event modify();   // same fallback
+
+    std::vector<Event> generate(size_t count);
+    size_t live_orders() const { return live_.size(); }
+    int mid_price() const { return mid_; }
+
+private:
+    struct LiveOrder
+    {
+        uint64_t order_id;
+        int price;
+        Side side;
+    };
+
+    Event make(EventType type, uint64_t order_id, int price, int quantity, Side side);
+    int passive_price(Side side);
+    size_t pick_live();
+    void remember(uint64_t order_id, int price, Side side);
+    void forget(size_t index);
+    void drift();
+
+    OrderFlowConfig config_;
+    std::mt19937_64 rng_;
+    std::discrete_distribution<int> kind_;
+    std::geometric_distribution<int> offset_;
+    std::uniform_int_distribution<int> quantity_;
+    std::uniform_real_distribution<double> unit_;
+    int mid_;
+    uint64_t next_order_id_ = 1;
+    uint64_t timestamp_ = 0;
+    std::vector<LiveOrder> live_; // unordered; removal swaps with the back
+};
+
+#endif // ORDERFLOW_H
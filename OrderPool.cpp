@@ -0,0 +1,96 @@
+#include "OrderPool.h"
+#include <stdexcept>
+
+OrderPool::OrderPool(size_t initial_capacity) : nodes_(initial_capacity > 0 ? initial_capacity : 1) {}
+
+uint32_t OrderPool::allocate(const Order &order)
+{
+    uint32_t idx;
+    if (free_head_ != NIL)
+    {
+        idx = free_head_;
+        free_head_ = nodes_[idx].next;
+    }
+    else
+    {
+        if (bump_ == nodes_.size())
+        {
+            if (nodes_.size() >= NIL / 2)
+                throw std::length_error("OrderPool: node index space exhausted");
+            nodes_.resize(nodes_.size() * 2);
+            ++grow_count_;
+        }
+        idx = static_cast<uint32_t>(bump_++);
+    }
+    OrderNode &node = nodes_[idx];
+    node.order = order;
+    node.prev = NIL;
+    node.next = NIL;
+    ++allocations_;
+    if (++in_use_ > high_water_)
+        high_water_ = in_use_;
+    return idx;
+}
+
+void OrderPool::release(uint32_t idx)
+{
+    nodes_[idx].next = free_head_;
+    free_head_ = idx;
+    --in_use_;
+}
+
+void OrderPool::reset()
+{
+    free_head_ = NIL;
+    bump_ = 0;
+    in_use_ = 0;
+    high_water_ = 0;
+}
+
+void OrderPool::push_back(PriceLevel &level, uint32_t idx)
+{
+    OrderNode &node = nodes_[idx];
+    node.prev = level.tail;
+    node.next = NIL;
+    if (level.tail != NIL)
+        nodes_[level.tail].next = idx;
+    else
+        level.head = idx;
+    level.tail = idx;
+    level.total_quantity += node.order.quantity;
+    ++level.order_count;
+}
+
+void OrderPool::unlink(PriceLevel &level, uint32_t idx)
+{
+    OrderNode &node = nodes_[idx];
+    if (node.prev != NIL)
+        nodes_[node.prev].next = node.next;
+    else
+        level.head = node.next;
+    if (node.next != NIL)
+        nodes_[node.next].prev = node.prev;
+    else
+        level.tail = node.prev;
+    node.prev = NIL;
+    node.next = NIL;
+    level.total_quantity -= node.order.quantity;
+    --level.order_count;
+}
+
+void OrderPool::reduce(PriceLevel &level, uint32_t idx, int quantity)
+{
+    nodes_[idx].order.quantity -= quantity;
+    level.total_quantity -= quantity;
+}
+
+OrderPoolStats OrderPool::stats() const
+{
+    OrderPoolStats s;
+    s.capacity = nodes_.size();
+    s.in_use = in_use_;
+    s.high_water = high_water_;
+    s.grow_count = grow_count_;
+    s.allocations = allocations_;
+    return s;
+}
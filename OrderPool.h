@@ -0,0 +1,88 @@
+#ifndef ORDERPOOL_H
+#define ORDERPOOL_H
+
+#include "DataTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Resting order with intrusive FIFO links (node indices into the pool)
+struct OrderNode
+{
+    Order order;
+    uint32_t prev;
+    uint32_t next;
+};
+
+// FIFO queue of resting orders at one price, threaded through pool nodes.
+// The aggregates are kept current by push_back/unlink/reduce.
+struct PriceLevel
+{
+    uint32_t head;
+    uint32_t tail;
+    int total_quantity;
+    uint32_t order_count;
+
+    PriceLevel();
+    bool empty() const;
+};
+
+struct OrderPoolStats
+{
+    size_t capacity = 0;      // nodes currently allocated
+    size_t in_use = 0;        // nodes holding a resting order
+    size_t high_water = 0;    // peak in_use since construction or reset()
+    size_t grow_count = 0;    // times the slab had to be enlarged
+    uint64_t allocations = 0; // total allocate() calls
+};
+
+// Slab of order nodes addressed by 32-bit index. Nodes are preallocated and
+// recycled through a free list, so adding and cancelling orders does not
+// touch the heap once the pool is warm; the slab only doubles when a replay
+// outgrows it. Indices stay valid across growth. The default start is small
+// because a book exists per token and most tokens rest few orders; busy
+// books reach their working size in a handful of doublings.
+class OrderPool
+{
+public:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    explicit OrderPool(size_t initial_capacity = DEFAULT_CAPACITY);
+
+    uint32_t allocate(const Order &order);
+    void release(uint32_t idx);
+    void reset(); // Drops every node but keeps the memory for the next replay
+
+    OrderNode &operator[](uint32_t idx) { return nodes_[idx]; }
+    const OrderNode &operator[](uint32_t idx) const { return nodes_[idx]; }
+
+    // Intrusive queue operations
+    void push_back(PriceLevel &level, uint32_t idx);
+    void unlink(PriceLevel &level, uint32_t idx);
+    void reduce(PriceLevel &level, uint32_t idx, int quantity); // Partial fill, keeps queue position
+
+    template <typename F>
+    void for_each(const PriceLevel &level, F &&f) const
+    {
+        for (uint32_t idx = level.head; idx != NIL; idx = nodes_[idx].next)
+            f(nodes_[idx].order);
+    }
+
+    OrderPoolStats stats() const;
+
+private:
+    std::vector<OrderNode> nodes_;
+    uint32_t free_head_ = NIL;
+    size_t bump_ = 0; // nodes below this index have been handed out at least once
+    size_t in_use_ = 0;
+    size_t high_water_ = 0;
+    size_t grow_count_ = 0;
+    uint64_t allocations_ = 0;
+};
+
+inline PriceLevel::PriceLevel() : head(OrderPool::NIL), tail(OrderPool::NIL), total_quantity(0), order_count(0) {}
+
+inline bool PriceLevel::empty() const { return head == OrderPool::NIL; }
+
+#endif // ORDERPOOL_H
@@ -0,0 +1,224 @@
+#include "Pipeline.h"
+#include "Metrics.h"
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Hands a whole batch downstream, yielding while the queue is full
+    template <typename T>
+    void push_batch(SpscQueue<T> &queue, const std::vector<T> &batch, StageStats &stats)
+    {
+        size_t sent = 0;
+        while (sent < batch.size())
+        {
+            size_t n = queue.try_push(batch.data() + sent, batch.size() - sent);
+            if (n == 0)
+            {
+                ++stats.full_stalls;
+                std::this_thread::yield();
+            }
+            sent += n;
+        }
+        stats.items += batch.size();
+        ++stats.batches;
+    }
+
+    // Fills batch with the next items, yielding while the queue is empty.
+    // Returns false once the producer has closed the queue and it is drained.
+    template <typename T>
+    bool pop_batch(SpscQueue<T> &queue, std::vector<T> &batch, size_t batch_size, StageStats &stats)
+    {
+        batch.resize(batch_size);
+        while (true)
+        {
+            size_t n = queue.try_pop(batch.data(), batch_size);
+            if (n == 0 && queue.closed())
+                n = queue.try_pop(batch.data(), batch_size); // items pushed just before close()
+            if (n > 0)
+            {
+                batch.resize(n);
+                return true;
+            }
+            if (queue.closed())
+                return false;
+            ++stats.empty_waits;
+            std::this_thread::yield();
+        }
+    }
+}
+
+ReplayPipeline::ReplayPipeline(BookManager &books, MetricsWriter &writer, const PipelineConfig &config)
+    : books_(books), writer_(writer), config_(config), events_(config.queue_capacity),
+      depths_(config.queue_capacity), rows_(config.queue_capacity)
+{
+    if (config_.batch_size == 0)
+        config_.batch_size = 1;
+    stats_[INGEST].name = "ingest";
+    stats_[BOOK].name = "book";
+    stats_[METRICS].name = "metrics";
+    stats_[OUTPUT].name = "output";
+}
+
+void ReplayPipeline::run(const EventSource &source, const BookManager::EventHandler &on_event)
+{
+    std::thread ingest([&]
+                       { ingest_stage(source); });
+    std::thread book([&]
+                     { book_stage(on_event); });
+    std::thread metrics([&]
+                        { metrics_stage(); });
+    output_stage();
+    ingest.join();
+    book.join();
+    metrics.join();
+}
+
+void ReplayPipeline::ingest_stage(const EventSource &source)
+{
+    Clock::time_point start = Clock::now();
+    std::vector<Event> batch;
+    batch.reserve(config_.batch_size);
+    Event event;
+    while (source(event))
+    {
+        batch.push_back(event);
+        if (batch.size() == config_.batch_size)
+        {
+            push_batch(events_, batch, stats_[INGEST]);
+            batch.clear();
+        }
+    }
+    if (!batch.empty())
+        push_batch(events_, batch, stats_[INGEST]);
+    events_.close();
+    stats_[INGEST].seconds = seconds_since(start);
+}
+
+void ReplayPipeline::book_stage(const BookManager::EventHandler &on_event)
+{
+    Clock::time_point start = Clock::now();
+    std::vector<Event> in;
+    std::vector<DepthRecord> out;
+    out.reserve(config_.batch_size);
+    std::pair<int, int> levels[MetricsColumns::LEVELS];
+    while (pop_batch(events_, in, config_.batch_size, stats_[BOOK]))
+    {
+        for (const Event &event : in)
+        {
+            size_t seq = books_.events_processed(event.token);
+            OrderBook &book = books_.process_event(event);
+
+            DepthRecord record;
+            record.timestamp = event.timestamp;
+            record.token = event.token;
+            std::pair<int, int> best = book.get_best_bid_ask();
+            record.best_bid = best.first;
+            record.best_ask = best.second;
+            record.n_bids = book.get_bids_depth(levels, MetricsColumns::LEVELS);
+            for (int i = 0; i < record.n_bids; ++i)
+                record.bid_qty[i] = levels[i].second;
+            record.n_asks = book.get_asks_depth(levels, MetricsColumns::LEVELS);
+            for (int i = 0; i < record.n_asks; ++i)
+                record.ask_qty[i] = levels[i].second;
+            out.push_back(record);
+
+            if (on_event)
+                on_event(book, event, seq);
+        }
+        push_batch(depths_, out, stats_[BOOK]);
+        out.clear();
+    }
+    depths_.close();
+    stats_[BOOK].seconds = seconds_since(start);
+}
+
+void ReplayPipeline::metrics_stage()
+{
+    Clock::time_point start = Clock::now();
+    std::vector<DepthRecord> in;
+    std::vector<MetricsRow> out;
+    out.reserve(config_.batch_size);
+    LOBMetrics metrics;
+    while (pop_batch(depths_, in, config_.batch_size, stats_[METRICS]))
+    {
+        for (const DepthRecord &record : in)
+        {
+            MetricsCalculator::calculate_from_depth(metrics, record.best_bid, record.best_ask, record.bid_qty,
+                                                    record.n_bids, record.ask_qty, record.n_asks,
+                                                    MetricsColumns::LEVELS, config_.decay_lambda);
+            MetricsRow row;
+            row.timestamp = record.timestamp;
+            row.token = record.token;
+            row.mid_price = metrics.mid_price;
+            row.spread = metrics.spread;
+            row.ofi_top = metrics.ofi_top;
+            row.ofi_depth = metrics.ofi_depth;
+            for (int lvl = 0; lvl < MetricsColumns::LEVELS; ++lvl)
+            {
+                row.bid_depth[lvl] = metrics.depth_bids[lvl];
+                row.ask_depth[lvl] = metrics.depth_asks[lvl];
+            }
+            out.push_back(row);
+        }
+        push_batch(rows_, out, stats_[METRICS]);
+        out.clear();
+    }
+    rows_.close();
+    stats_[METRICS].seconds = seconds_since(start);
+}
+
+void ReplayPipeline::output_stage()
+{
+    Clock::time_point start = Clock::now();
+    std::vector<MetricsRow> in;
+    MetricsColumns columns;
+    while (pop_batch(rows_, in, config_.batch_size, stats_[OUTPUT]))
+    {
+        for (const MetricsRow &row : in)
+        {
+            columns.timestamp_raw.push_back(row.timestamp);
+            columns.token.push_back(row.token);
+            columns.mid_price.push_back(row.mid_price);
+            columns.spread.push_back(row.spread);
+            columns.ofi_top.push_back(row.ofi_top);
+            columns.ofi_depth.push_back(row.ofi_depth);
+            for (int lvl = 0; lvl < MetricsColumns::LEVELS; ++lvl)
+            {
+                columns.bid_depth[lvl].push_back(row.bid_depth[lvl]);
+                columns.ask_depth[lvl].push_back(row.ask_depth[lvl]);
+            }
+        }
+        writer_.write(columns);
+        columns.clear();
+        stats_[OUTPUT].items += in.size();
+        ++stats_[OUTPUT].batches;
+    }
+    stats_[OUTPUT].seconds = seconds_since(start);
+}
+
+void ReplayPipeline::report(std::ostream &os) const
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "Pipeline stages (items/s, back-pressure stalls on full output, waits on empty input):\n";
+    for (const StageStats &s : stats_)
+    {
+        double rate = s.seconds > 0 ? s.items / s.seconds : 0.0;
+        os << "  " << std::left << std::setw(8) << s.name << std::right
+           << std::setw(10) << s.items << " items in " << std::setw(6) << s.batches << " batches, "
+           << std::fixed << std::setprecision(0) << std::setw(10) << rate << " items/s, "
+           << std::setw(8) << s.full_stalls << " stalls, " << std::setw(8) << s.empty_waits << " waits\n";
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
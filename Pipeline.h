@@ -0,0 +1,95 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "BookManager.h"
+#include "MetricsWriter.h"
+#include "SpscQueue.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+struct PipelineConfig
+{
+    size_t queue_capacity = 1 << 14; // items per inter-stage queue
+    size_t batch_size = 512;         // items handed over per queue operation
+    double decay_lambda = 0.5;
+};
+
+struct StageStats
+{
+    const char *name = "";
+    uint64_t items = 0;      // items this stage produced
+    uint64_t batches = 0;    // batches it handed downstream
+    uint64_t full_stalls = 0; // times it waited on a full output queue (back-pressure)
+    uint64_t empty_waits = 0; // times it waited on an empty input queue
+    double seconds = 0.0;     // wall time from start to finishing its last item
+};
+
+// Sequential replay split into four threads joined by SPSC queues:
+//   ingest -> book update -> metrics -> output writer
+// Ingest reads events from the source, the book stage applies them and
+// copies out the top MetricsColumns::LEVELS levels, the metrics stage turns
+// that into rows, and the writer (on the calling thread) writes them. Rows
+// come out in input order, exactly as a single-threaded replay writes them.
+class ReplayPipeline
+{
+public:
+    using EventSource = std::function<bool(Event &event)>; // False once drained
+
+    ReplayPipeline(BookManager &books, MetricsWriter &writer, const PipelineConfig &config = PipelineConfig());
+
+    // on_event runs on the book stage after each event, as in BookManager::replay
+    void run(const EventSource &source, const BookManager::EventHandler &on_event = nullptr);
+
+    enum Stage
+    {
+        INGEST,
+        BOOK,
+        METRICS,
+        OUTPUT,
+        STAGE_COUNT
+    };
+    const StageStats &stats(Stage stage) const { return stats_[stage]; }
+    void report(std::ostream &os) const;
+
+private:
+    // What the metrics stage needs from the book after one event
+    struct DepthRecord
+    {
+        uint64_t timestamp;
+        uint64_t token;
+        int best_bid;
+        int best_ask;
+        int n_bids;
+        int n_asks;
+        int bid_qty[MetricsColumns::LEVELS];
+        int ask_qty[MetricsColumns::LEVELS];
+    };
+
+    struct MetricsRow
+    {
+        uint64_t timestamp;
+        uint64_t token;
+        double mid_price;
+        int spread;
+        double ofi_top;
+        double ofi_depth;
+        double bid_depth[MetricsColumns::LEVELS];
+        double ask_depth[MetricsColumns::LEVELS];
+    };
+
+    void ingest_stage(const EventSource &source);
+    void book_stage(const BookManager::EventHandler &on_event);
+    void metrics_stage();
+    void output_stage();
+
+    BookManager &books_;
+    MetricsWriter &writer_;
+    PipelineConfig config_;
+    SpscQueue<Event> events_;
+    SpscQueue<DepthRecord> depths_;
+    SpscQueue<MetricsRow> rows_;
+    StageStats stats_[STAGE_COUNT];
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,275 @@
+#ifndef PRICELADDER_H
+#define PRICELADDER_H
+
+#include "DataTypes.h"
+#include "OrderPool.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+// Both ladders expose the same interface, ordered best price first:
+//   empty(), size(), best_price(), best_level(), find(price),
+//   insert(price) (get-or-create), erase(price) (drop an emptied level),
+//   visit(f) with f(price, level) returning false to stop the walk.
+
+// Tree-backed ladder; one red-black node per non-empty price
+template <Side S>
+class MapLadder
+{
+    using Compare = typename std::conditional<S == Side::BUY, std::greater<int>, std::less<int>>::type;
+
+public:
+    bool empty() const { return levels_.empty(); }
+    size_t size() const { return levels_.size(); }
+    int best_price() const { return levels_.begin()->first; }
+    PriceLevel &best_level() { return levels_.begin()->second; }
+
+    PriceLevel *find(int price)
+    {
+        auto it = levels_.find(price);
+        return it == levels_.end() ? nullptr : &it->second;
+    }
+    const PriceLevel *find(int price) const
+    {
+        auto it = levels_.find(price);
+        return it == levels_.end() ? nullptr : &it->second;
+    }
+
+    PriceLevel &insert(int price) { return levels_[price]; }
+    void erase(int price) { levels_.erase(price); }
+
+    template <typename F>
+    void visit(F &&f) const
+    {
+        for (auto it = levels_.begin(); it != levels_.end(); ++it)
+            if (!f(it->first, it->second))
+                return;
+    }
+
+private:
+    std::map<int, PriceLevel, Compare> levels_;
+};
+
+// Contiguous ladder indexed by price tick (one minor unit) relative to a
+// movable base. A bitmap of non-empty ticks finds the next level without
+// touching empty slots, and the best index is cached. The window recenters
+// (and doubles when needed) as prices drift; prices that would stretch it
+// past MAX_TICKS rest in an ordered overflow map instead, which the window
+// absorbs again once a later recenter covers them. Nothing is allocated
+// until the first insert, and the first window is small so idle books stay
+// cheap.
+template <Side S>
+class FlatLadder
+{
+    using Compare = typename std::conditional<S == Side::BUY, std::greater<int>, std::less<int>>::type;
+    static constexpr bool IS_BID = (S == Side::BUY);
+
+public:
+    static constexpr int INITIAL_TICKS = 256; // a multiple of 64 (bitmap words)
+    static constexpr int MAX_TICKS = 1 << 20;
+
+    bool empty() const { return count_ == 0 && overflow_.empty(); }
+    size_t size() const { return count_ + overflow_.size(); }
+
+    int best_price() const
+    {
+        if (best_ != NONE && (overflow_.empty() || better(base_ + best_, overflow_.begin()->first)))
+            return base_ + best_;
+        return overflow_.begin()->first;
+    }
+
+    PriceLevel &best_level()
+    {
+        if (best_ != NONE && (overflow_.empty() || better(base_ + best_, overflow_.begin()->first)))
+            return levels_[best_];
+        return overflow_.begin()->second;
+    }
+
+    PriceLevel *find(int price)
+    {
+        int idx = price - base_;
+        if (in_window(idx))
+            return test(idx) ? &levels_[idx] : nullptr;
+        auto it = overflow_.find(price);
+        return it == overflow_.end() ? nullptr : &it->second;
+    }
+    const PriceLevel *find(int price) const
+    {
+        return const_cast<FlatLadder *>(this)->find(price);
+    }
+
+    PriceLevel &insert(int price)
+    {
+        int idx = price - base_;
+        if (!in_window(idx))
+        {
+            auto it = overflow_.find(price);
+            if (it != overflow_.end())
+                return it->second;
+            if (!recenter(price))
+                return overflow_[price];
+            idx = price - base_;
+        }
+        if (!test(idx))
+        {
+            set(idx);
+            ++count_;
+            if (best_ == NONE || (IS_BID ? idx > best_ : idx < best_))
+                best_ = idx;
+        }
+        return levels_[idx];
+    }
+
+    void erase(int price)
+    {
+        int idx = price - base_;
+        if (!in_window(idx))
+        {
+            overflow_.erase(price);
+            return;
+        }
+        if (!test(idx))
+            return;
+        clear(idx);
+        levels_[idx] = PriceLevel();
+        --count_;
+        if (idx == best_)
+            best_ = IS_BID ? scan_down(idx - 1) : scan_up(idx + 1);
+    }
+
+    template <typename F>
+    void visit(F &&f) const
+    {
+        auto ov = overflow_.begin();
+        int idx = best_;
+        while (idx != NONE || ov != overflow_.end())
+        {
+            if (idx != NONE && (ov == overflow_.end() || better(base_ + idx, ov->first)))
+            {
+                if (!f(base_ + idx, levels_[idx]))
+                    return;
+                idx = IS_BID ? scan_down(idx - 1) : scan_up(idx + 1);
+            }
+            else
+            {
+                if (!f(ov->first, ov->second))
+                    return;
+                ++ov;
+            }
+        }
+    }
+
+private:
+    static constexpr int NONE = -1;
+
+    static bool better(int a, int b) { return Compare()(a, b); }
+
+    int ticks() const { return static_cast<int>(levels_.size()); }
+    bool in_window(int idx) const { return idx >= 0 && idx < ticks(); }
+    bool test(int idx) const { return (bits_[idx >> 6] >> (idx & 63)) & 1ULL; }
+    void set(int idx) { bits_[idx >> 6] |= 1ULL << (idx & 63); }
+    void clear(int idx) { bits_[idx >> 6] &= ~(1ULL << (idx & 63)); }
+
+    // Lowest non-empty index >= from, or NONE
+    int scan_up(int from) const
+    {
+        if (from < 0)
+            from = 0;
+        if (from >= ticks())
+            return NONE;
+        size_t w = static_cast<size_t>(from) >> 6;
+        uint64_t word = bits_[w] & (~0ULL << (from & 63));
+        while (true)
+        {
+            if (word)
+                return static_cast<int>(w * 64 + __builtin_ctzll(word));
+            if (++w == bits_.size())
+                return NONE;
+            word = bits_[w];
+        }
+    }
+
+    // Highest non-empty index <= from, or NONE
+    int scan_down(int from) const
+    {
+        if (from < 0)
+            return NONE;
+        if (from >= ticks())
+            from = ticks() - 1;
+        size_t w = static_cast<size_t>(from) >> 6;
+        uint64_t word = bits_[w] & (~0ULL >> (63 - (from & 63)));
+        while (true)
+        {
+            if (word)
+                return static_cast<int>(w * 64 + 63 - __builtin_clzll(word));
+            if (w-- == 0)
+                return NONE;
+            word = bits_[w];
+        }
+    }
+
+    // Moves the window so that price and every occupied tick fit, centred on
+    // their span with at least as much headroom again. Returns false when
+    // that would need more than MAX_TICKS.
+    bool recenter(int price)
+    {
+        int64_t lo = price, hi = price;
+        if (count_ > 0)
+        {
+            lo = std::min<int64_t>(lo, base_ + scan_up(0));
+            hi = std::max<int64_t>(hi, base_ + scan_down(ticks() - 1));
+        }
+        int64_t span = hi - lo + 1;
+        int64_t new_ticks = levels_.empty() ? INITIAL_TICKS : ticks();
+        while (new_ticks < span * 2)
+            new_ticks *= 2;
+        if (new_ticks > MAX_TICKS)
+            return false;
+
+        int new_base = static_cast<int>(lo + span / 2 - new_ticks / 2);
+        std::vector<PriceLevel> new_levels(static_cast<size_t>(new_ticks));
+        std::vector<uint64_t> new_bits(static_cast<size_t>(new_ticks) / 64, 0);
+        int new_best = NONE;
+        for (int idx = scan_up(0); idx != NONE; idx = scan_up(idx + 1))
+        {
+            int moved = base_ + idx - new_base;
+            new_levels[moved] = std::move(levels_[idx]);
+            new_bits[moved >> 6] |= 1ULL << (moved & 63);
+            if (idx == best_)
+                new_best = moved;
+        }
+        // Overflow prices that the new window covers move into the array
+        for (auto it = overflow_.begin(); it != overflow_.end();)
+        {
+            int64_t moved = static_cast<int64_t>(it->first) - new_base;
+            if (moved < 0 || moved >= new_ticks)
+            {
+                ++it;
+                continue;
+            }
+            new_levels[moved] = std::move(it->second);
+            new_bits[moved >> 6] |= 1ULL << (moved & 63);
+            ++count_;
+            if (new_best == NONE || (IS_BID ? moved > new_best : moved < new_best))
+                new_best = static_cast<int>(moved);
+            it = overflow_.erase(it);
+        }
+        levels_.swap(new_levels);
+        bits_.swap(new_bits);
+        base_ = new_base;
+        best_ = new_best;
+        return true;
+    }
+
+    std::vector<PriceLevel> levels_;
+    std::vector<uint64_t> bits_;
+    int base_ = 0;
+    int best_ = NONE;
+    size_t count_ = 0;
+    std::map<int, PriceLevel, Compare> overflow_;
+};
+
+#endif // PRICELADDER_H
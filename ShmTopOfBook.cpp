@@ -0,0 +1,252 @@
+#include "ShmTopOfBook.h"
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LOB_HAVE_SHM 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char MAGIC[8] = {'L', 'O', 'B', 'T', 'O', 'P', '\0', '\0'};
+
+    uint64_t magic_word()
+    {
+        uint64_t word;
+        std::memcpy(&word, MAGIC, sizeof(word));
+        return word;
+    }
+
+    std::string shm_path(const std::string &name)
+    {
+        return name.empty() || name[0] == '/' ? name : "/" + name;
+    }
+
+    void write_slot(ShmBook::Slot &slot, const TopOfBook &top)
+    {
+        uint64_t words[ShmBook::PAYLOAD_WORDS];
+        std::memcpy(words, &top, sizeof(top));
+        uint64_t seq = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t w = 0; w < ShmBook::PAYLOAD_WORDS; ++w)
+            slot.payload[w].store(words[w], std::memory_order_relaxed);
+        slot.sequence.store(seq + 2, std::memory_order_release);
+    }
+}
+
+ShmBookPublisher::~ShmBookPublisher()
+{
+    close();
+}
+
+bool ShmBookPublisher::open(const std::string &name, uint32_t max_tokens, std::string &error)
+{
+    close();
+#ifdef LOB_HAVE_SHM
+    std::string path = shm_path(name);
+    size_t size = sizeof(ShmBook::Header) + static_cast<size_t>(max_tokens) * sizeof(ShmBook::Slot);
+    shm_unlink(path.c_str()); // never attach to a stale layout
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        error = "cannot create shared memory " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        error = "cannot map shared memory " + path + ": " + std::strerror(errno);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    // ftruncate zero-fills, which is a valid state for every atomic here
+    header_ = new (p) ShmBook::Header();
+    slots_ = reinterpret_cast<ShmBook::Slot *>(static_cast<char *>(p) + sizeof(ShmBook::Header));
+    header_->version = ShmBook::VERSION;
+    header_->slot_count = max_tokens;
+    header_->slot_size = sizeof(ShmBook::Slot);
+    header_->depth = TopOfBook::DEPTH;
+    header_->slots_used.store(0, std::memory_order_relaxed);
+    // Magic last: a reader whose acquire load sees it sees a complete header
+    header_->magic.store(magic_word(), std::memory_order_release);
+    name_ = path;
+    base_ = p;
+    size_ = size;
+    return true;
+#else
+    (void)name;
+    (void)max_tokens;
+    error = "shared memory publishing is not supported on this platform";
+    return false;
+#endif
+}
+
+void ShmBookPublisher::close()
+{
+#ifdef LOB_HAVE_SHM
+    if (base_)
+    {
+        munmap(base_, size_);
+        shm_unlink(name_.c_str());
+    }
+#endif
+    base_ = nullptr;
+    header_ = nullptr;
+    slots_ = nullptr;
+    token_slot_.clear();
+}
+
+int ShmBookPublisher::attach(uint64_t token)
+{
+    auto it = token_slot_.find(token);
+    if (it != token_slot_.end())
+        return it->second;
+    if (!header_ || token_slot_.size() >= header_->slot_count)
+        return -1;
+    int slot = static_cast<int>(token_slot_.size());
+    TopOfBook empty;
+    std::memset(&empty, 0, sizeof(empty));
+    empty.token = token;
+    write_slot(slots_[slot], empty);
+    header_->slots_used.store(slot + 1, std::memory_order_release);
+    token_slot_[token] = slot;
+    return slot;
+}
+
+void ShmBookPublisher::publish(int slot, const OrderBook &book, uint64_t timestamp, uint64_t events)
+{
+    if (slot < 0)
+        return;
+    TopOfBook top;
+    std::memset(&top, 0, sizeof(top));
+    std::pair<int, int> levels[TopOfBook::DEPTH];
+    top.timestamp = timestamp;
+    top.events = events;
+    top.bid_count = book.get_bids_depth(levels, TopOfBook::DEPTH);
+    for (int i = 0; i < top.bid_count; ++i)
+    {
+        top.bids[i][0] = levels[i].first;
+        top.bids[i][1] = levels[i].second;
+    }
+    top.ask_count = book.get_asks_depth(levels, TopOfBook::DEPTH);
+    for (int i = 0; i < top.ask_count; ++i)
+    {
+        top.asks[i][0] = levels[i].first;
+        top.asks[i][1] = levels[i].second;
+    }
+    top.best_bid = top.bid_count > 0 ? top.bids[0][0] : 0;
+    top.best_ask = top.ask_count > 0 ? top.asks[0][0] : 0;
+    // The token word never changes after attach; read it back from the slot
+    top.token = slots_[slot].payload[0].load(std::memory_order_relaxed);
+    write_slot(slots_[slot], top);
+}
+
+ShmBookReader::~ShmBookReader()
+{
+    close();
+}
+
+bool ShmBookReader::open(const std::string &name, std::string &error)
+{
+    close();
+#ifdef LOB_HAVE_SHM
+    std::string path = shm_path(name);
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        error = "cannot open shared memory " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmBook::Header))
+        p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        error = "cannot map shared memory " + path;
+        return false;
+    }
+    base_ = p;
+    size_ = static_cast<size_t>(st.st_size);
+    header_ = static_cast<const ShmBook::Header *>(p);
+    if (header_->magic.load(std::memory_order_acquire) != magic_word() || header_->version != ShmBook::VERSION ||
+        header_->slot_size != sizeof(ShmBook::Slot) ||
+        size_ < sizeof(ShmBook::Header) + static_cast<size_t>(header_->slot_count) * sizeof(ShmBook::Slot))
+    {
+        error = path + " is not a compatible top-of-book segment";
+        close();
+        return false;
+    }
+    slots_ = reinterpret_cast<const ShmBook::Slot *>(static_cast<const char *>(p) + sizeof(ShmBook::Header));
+    return true;
+#else
+    (void)name;
+    error = "shared memory publishing is not supported on this platform";
+    return false;
+#endif
+}
+
+void ShmBookReader::close()
+{
+#ifdef LOB_HAVE_SHM
+    if (base_)
+        munmap(base_, size_);
+#endif
+    base_ = nullptr;
+    header_ = nullptr;
+    slots_ = nullptr;
+}
+
+size_t ShmBookReader::token_count() const
+{
+    return header_ ? header_->slots_used.load(std::memory_order_acquire) : 0;
+}
+
+bool ShmBookReader::read_slot(size_t i, TopOfBook &out) const
+{
+    if (i >= token_count())
+        return false;
+    const ShmBook::Slot &slot = slots_[i];
+    uint64_t words[ShmBook::PAYLOAD_WORDS];
+    for (int attempt = 0; attempt < MAX_RETRIES; ++attempt)
+    {
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            std::this_thread::yield(); // writer inside; let it finish
+            continue;
+        }
+        for (size_t w = 0; w < ShmBook::PAYLOAD_WORDS; ++w)
+            words[w] = slot.payload[w].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before)
+        {
+            std::memcpy(&out, words, sizeof(out));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShmBookReader::read(uint64_t token, TopOfBook &out) const
+{
+    size_t n = token_count();
+    for (size_t i = 0; i < n; ++i)
+    {
+        // The token word is fixed once the slot is in use
+        if (slots_[i].payload[0].load(std::memory_order_relaxed) == token)
+            return read_slot(i, out);
+    }
+    return false;
+}
@@ -0,0 +1,111 @@
+#ifndef SHMTOPOFBOOK_H
+#define SHMTOPOFBOOK_H
+
+#include "OrderBook.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Consistent copy of one token's book top as last published
+struct TopOfBook
+{
+    static constexpr int DEPTH = 10;
+
+    uint64_t token;
+    uint64_t timestamp; // raw exchange timestamp of the last event applied
+    uint64_t events;    // events applied to this token's book so far
+    int32_t best_bid;   // 0 when the side is empty
+    int32_t best_ask;
+    int32_t bid_count;  // levels filled in bids/asks, at most DEPTH
+    int32_t ask_count;
+    int32_t bids[DEPTH][2]; // price, aggregate quantity; best first
+    int32_t asks[DEPTH][2];
+};
+
+static_assert(sizeof(TopOfBook) % 8 == 0, "TopOfBook must be whole words");
+
+// Shared-memory layout: a header, then one cache-line aligned slot per token.
+// Each slot is a seqlock: the sequence is odd while the writer is inside,
+// and the payload is copied as relaxed atomic words so neither side races.
+namespace ShmBook
+{
+    const uint32_t VERSION = 1;
+    constexpr size_t PAYLOAD_WORDS = sizeof(TopOfBook) / 8;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> payload[PAYLOAD_WORDS];
+    };
+
+    struct alignas(64) Header
+    {
+        std::atomic<uint64_t> magic; // "LOBTOP\0\0" as bytes; stored last, release
+        uint32_t version;
+        uint32_t slot_count;
+        uint32_t slot_size;
+        uint32_t depth;
+        std::atomic<uint32_t> slots_used; // slots [0, slots_used) carry a token
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock needs lock-free 64-bit atomics");
+}
+
+// Single writer per slot. Slots are handed out by attach() on one thread;
+// after that each token may be published from whichever thread owns it.
+class ShmBookPublisher
+{
+public:
+    ShmBookPublisher() = default;
+    ~ShmBookPublisher();
+    ShmBookPublisher(const ShmBookPublisher &) = delete;
+    ShmBookPublisher &operator=(const ShmBookPublisher &) = delete;
+
+    // Creates (or replaces) the segment /name with room for max_tokens books
+    bool open(const std::string &name, uint32_t max_tokens, std::string &error);
+    // Unmaps and removes the segment; readers already attached keep their view
+    void close();
+
+    // Slot for token, or -1 once every slot is taken
+    int attach(uint64_t token);
+    void publish(int slot, const OrderBook &book, uint64_t timestamp, uint64_t events);
+
+private:
+    std::string name_;
+    void *base_ = nullptr;
+    size_t size_ = 0;
+    ShmBook::Header *header_ = nullptr;
+    ShmBook::Slot *slots_ = nullptr;
+    std::unordered_map<uint64_t, int> token_slot_;
+};
+
+// Lock-free reader; never blocks the publisher
+class ShmBookReader
+{
+public:
+    static constexpr int MAX_RETRIES = 1000;
+
+    ShmBookReader() = default;
+    ~ShmBookReader();
+    ShmBookReader(const ShmBookReader &) = delete;
+    ShmBookReader &operator=(const ShmBookReader &) = delete;
+
+    bool open(const std::string &name, std::string &error);
+    void close();
+
+    size_t token_count() const;
+    // Reads slot i; false if it kept changing for MAX_RETRIES attempts
+    bool read_slot(size_t i, TopOfBook &out) const;
+    // false if the token is not published or no consistent copy was read
+    bool read(uint64_t token, TopOfBook &out) const;
+
+private:
+    void *base_ = nullptr;
+    size_t size_ = 0;
+    const ShmBook::Header *header_ = nullptr;
+    const ShmBook::Slot *slots_ = nullptr;
+};
+
+#endif // SHMTOPOFBOOK_H
@@ -0,0 +1,89 @@
+#include "SnapshotRing.h"
+
+SnapshotRing::SnapshotRing(size_t capacity, int depth)
+    : capacity_(capacity), depth_(depth > 0 ? depth : 0) {}
+
+bool SnapshotRing::begin_push(uint64_t timestamp, std::pair<int, int> *&bids, std::pair<int, int> *&asks)
+{
+    if (capacity_ == 0)
+        return false;
+    if (slots_.empty())
+    {
+        slots_.resize(capacity_);
+        levels_.resize(capacity_ * static_cast<size_t>(depth_) * 2);
+    }
+    if (size_ == capacity_)
+    {
+        head_ = slot(1);
+        --size_;
+    }
+    pending_ = slot(size_);
+    slots_[pending_].timestamp = timestamp;
+    bids = levels_.data() + pending_ * depth_ * 2;
+    asks = bids + depth_;
+    return true;
+}
+
+void SnapshotRing::commit(int bid_count, int ask_count)
+{
+    slots_[pending_].bid_count = bid_count;
+    slots_[pending_].ask_count = ask_count;
+    ++size_;
+}
+
+void SnapshotRing::trim(size_t max_count)
+{
+    if (size_ <= max_count)
+        return;
+    head_ = slot(size_ - max_count);
+    size_ = max_count;
+}
+
+void SnapshotRing::clear()
+{
+    head_ = 0;
+    size_ = 0;
+}
+
+OrderBookSnapshot SnapshotRing::operator[](size_t i) const
+{
+    size_t s = slot(i);
+    const Slot &meta = slots_[s];
+    const std::pair<int, int> *bids = levels_.data() + s * depth_ * 2;
+    return {meta.timestamp, meta.bid_count, meta.ask_count, bids, bids + depth_};
+}
+
+size_t SnapshotRing::lower_bound(uint64_t timestamp) const
+{
+    size_t lo = 0, hi = size_;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (slots_[slot(mid)].timestamp < timestamp)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+size_t SnapshotRing::upper_bound(uint64_t timestamp) const
+{
+    size_t lo = 0, hi = size_;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (slots_[slot(mid)].timestamp <= timestamp)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+std::pair<SnapshotRing::const_iterator, SnapshotRing::const_iterator> SnapshotRing::between(uint64_t from, uint64_t to) const
+{
+    size_t first = lower_bound(from);
+    size_t last = from <= to ? upper_bound(to) : first;
+    return {const_iterator(this, first), const_iterator(this, last)};
+}
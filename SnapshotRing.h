@@ -0,0 +1,139 @@
+#ifndef SNAPSHOTRING_H
+#define SNAPSHOTRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Book snapshot for rolling buffer analytics. A view into the ring's
+// storage: valid until the ring overwrites that slot.
+struct OrderBookSnapshot
+{
+    uint64_t timestamp;
+    int bid_count; // levels held, best first, at most the ring's depth
+    int ask_count;
+    const std::pair<int, int> *bid_levels; // price, total qty
+    const std::pair<int, int> *ask_levels;
+};
+
+// Fixed-capacity ring of book snapshots. Every slot and its level arrays are
+// allocated together on the first push, so a book that never snapshots pays
+// nothing and later snapshots never allocate; once full the oldest snapshot
+// is overwritten. Index 0 is the oldest. Timestamps are
+// expected to be non-decreasing, which lets range queries binary search.
+class SnapshotRing
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = OrderBookSnapshot;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = OrderBookSnapshot;
+
+        const_iterator() : ring_(nullptr), index_(0) {}
+        const_iterator(const SnapshotRing *ring, size_t index) : ring_(ring), index_(index) {}
+
+        OrderBookSnapshot operator*() const { return (*ring_)[index_]; }
+        OrderBookSnapshot operator[](difference_type n) const { return (*ring_)[index_ + n]; }
+        const_iterator &operator++()
+        {
+            ++index_;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++index_;
+            return old;
+        }
+        const_iterator &operator--()
+        {
+            --index_;
+            return *this;
+        }
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --index_;
+            return old;
+        }
+        const_iterator &operator+=(difference_type n)
+        {
+            index_ += n;
+            return *this;
+        }
+        const_iterator &operator-=(difference_type n)
+        {
+            index_ -= n;
+            return *this;
+        }
+        const_iterator operator+(difference_type n) const { return const_iterator(ring_, index_ + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(ring_, index_ - n); }
+        difference_type operator-(const const_iterator &other) const
+        {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+        }
+        bool operator==(const const_iterator &other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator &other) const { return index_ != other.index_; }
+        bool operator<(const const_iterator &other) const { return index_ < other.index_; }
+
+    private:
+        const SnapshotRing *ring_;
+        size_t index_;
+    };
+
+    SnapshotRing(size_t capacity, int depth);
+
+    size_t capacity() const { return capacity_; }
+    int depth() const { return depth_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Claims the next slot (overwriting the oldest when full) and returns its
+    // level arrays, each depth() long, for the caller to fill; commit() then
+    // records how many levels were written. Returns false when capacity is 0.
+    bool begin_push(uint64_t timestamp, std::pair<int, int> *&bids, std::pair<int, int> *&asks);
+    void commit(int bid_count, int ask_count);
+
+    // Drops the oldest snapshots until at most max_count remain
+    void trim(size_t max_count);
+    void clear();
+
+    OrderBookSnapshot operator[](size_t i) const;
+    OrderBookSnapshot front() const { return (*this)[0]; }
+    OrderBookSnapshot back() const { return (*this)[size_ - 1]; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size_); }
+
+    // Index of the first snapshot at or after timestamp (size() if none)
+    size_t lower_bound(uint64_t timestamp) const;
+    // Index of the first snapshot after timestamp (size() if none)
+    size_t upper_bound(uint64_t timestamp) const;
+    // Snapshots with from <= timestamp <= to, as an iterator range
+    std::pair<const_iterator, const_iterator> between(uint64_t from, uint64_t to) const;
+
+private:
+    size_t slot(size_t i) const { return (head_ + i) % capacity_; }
+
+    struct Slot
+    {
+        uint64_t timestamp = 0;
+        int bid_count = 0;
+        int ask_count = 0;
+    };
+
+    size_t capacity_;
+    int depth_;
+    std::vector<Slot> slots_;
+    std::vector<std::pair<int, int>> levels_; // per slot: depth bids then depth asks
+    size_t head_ = 0;                         // slot of the oldest snapshot
+    size_t size_ = 0;
+    size_t pending_ = 0; // slot claimed by the last begin_push
+};
+
+#endif // SNAPSHOTRING_H
@@ -0,0 +1,84 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Items move in batches: each try_push/try_pop copies as many items
+// as fit and publishes them with a single release store. Each side caches
+// the other's index so the shared cache line is only read when the cached
+// view says the queue looks full (or empty).
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity) : buffer_(round_up(capacity)), mask_(buffer_.size() - 1) {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    size_t capacity() const { return buffer_.size(); }
+
+    // Producer: copies up to n items, returns how many were queued
+    size_t try_push(const T *items, size_t n)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free_slots = buffer_.size() - (tail - head_cache_);
+        if (free_slots < n)
+        {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            free_slots = buffer_.size() - (tail - head_cache_);
+        }
+        if (n > free_slots)
+            n = free_slots;
+        for (size_t i = 0; i < n; ++i)
+            buffer_[(tail + i) & mask_] = items[i];
+        if (n > 0)
+            tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: moves up to max items into out, returns how many
+    size_t try_pop(T *out, size_t max)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t ready = tail_cache_ - head;
+        if (ready < max)
+        {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            ready = tail_cache_ - head;
+        }
+        if (max > ready)
+            max = ready;
+        for (size_t i = 0; i < max; ++i)
+            out[i] = buffer_[(head + i) & mask_];
+        if (max > 0)
+            head_.store(head + max, std::memory_order_release);
+        return max;
+    }
+
+    // Producer: no more items will follow
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    static size_t round_up(size_t n)
+    {
+        size_t c = 2;
+        while (c < n)
+            c *= 2;
+        return c;
+    }
+
+    std::vector<T> buffer_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0}; // next slot to read, written by the consumer
+    size_t tail_cache_ = 0;                   // consumer's last view of tail_
+    alignas(64) std::atomic<size_t> tail_{0}; // next slot to write, written by the producer
+    size_t head_cache_ = 0;                   // producer's last view of head_
+    alignas(64) std::atomic<bool> closed_{false};
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,76 @@
+#include "ThreadPool.h"
+#include "Diagnostics.h"
+
+size_t ThreadPool::default_size()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+ThreadPool::ThreadPool(size_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = default_size();
+    workers_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i)
+        workers_.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto &w : workers_)
+        w.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    // The task's diagnostics go where the submitter's would
+    if (DiagnosticsBuffer *sink = Diagnostics::sink())
+        task = [sink, task = std::move(task)]
+        {
+            DiagnosticsSinkScope scope(sink);
+            task();
+        };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_cv_.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]
+                  { return tasks_.empty() && active_ == 0; });
+}
+
+void ThreadPool::worker_loop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_cv_.wait(lock, [this]
+                          { return stopping_ || !tasks_.empty(); });
+            if (stopping_ && tasks_.empty())
+                return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            ++active_;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+            if (tasks_.empty() && active_ == 0)
+                idle_cv_.notify_all();
+        }
+    }
+}
@@ -1,9 +1,9 @@
 #include "Utils.h"
+#include "Diagnostics.h"
+#include <charconv>
+#include <cstring>
 #include <sstream>
 #include <stdexcept>
-#include <chrono>
-#include <iomanip>
-#include <iostream>
 
 std::vector<std::string> Utils::split(const std::string &s, char delimiter)
 {
@@ -17,92 +17,142 @@ std::vector<std::string> Utils::split(const std::string &s, char delimiter)
     return tokens;
 }
 
-Event Utils::parse_line(const std::string &line, bool is_trade_file)
+namespace
 {
-    Event event;
-    std::vector<std::string> tokens = split(line, ',');
+    const size_t CSV_FIELDS = 12; // Both NSE formats carry 12 columns
 
-    try
+    // Splits line on ',' into at most CSV_FIELDS views; returns the field count
+    size_t split_fields(std::string_view line, std::string_view *fields)
     {
-        // Minimal size check (12 fields for both formats)
-        if (tokens.size() < 12)
+        size_t n = 0;
+        size_t start = 0;
+        while (n < CSV_FIELDS)
         {
-            std::cerr << "[parse_line] Corrupt line: " << line << std::endl;
-            event.timestamp = 0;
-            return event;
+            size_t comma = line.find(',', start);
+            if (comma == std::string_view::npos)
+            {
+                fields[n++] = line.substr(start);
+                break;
+            }
+            fields[n++] = line.substr(start, comma - start);
+            start = comma + 1;
         }
-        uint64_t time_micro = std::stoull(tokens[1]);
-        uint64_t time_nano = std::stoull(tokens[6]);
-        event.timestamp = time_micro * 1000 + time_nano;
+        return n;
+    }
 
-        if (is_trade_file)
-        {
-            // TRADE FILE columns
-            // [7]=Order_No_B, [8]=Order_No_S, [9]=Token, [10]=Price, [11]=Quantity
-            event.type = EventType::TRADE;
-            event.buy_order_id = std::stoull(tokens[7]);
-            event.sell_order_id = std::stoull(tokens[8]);
-            event.token = std::stoull(tokens[9]);
-            event.price = std::stoi(tokens[10]);
-            event.quantity = std::stoi(tokens[11]);
-            event.side = Side::BUY; // Not meaningful for trade itself
-            event.order_id = 0;     // No single relevant order in trade event
-        }
+    // Leading whitespace is skipped and anything after the digits ignored,
+    // matching what std::stoull/std::stoi accepted
+    template <typename T>
+    bool parse_int(std::string_view field, T &value)
+    {
+        const char *first = field.data();
+        const char *last = first + field.size();
+        while (first != last && (*first == ' ' || *first == '\t'))
+            ++first;
+        if (first != last && *first == '+')
+            ++first;
+        std::from_chars_result res = std::from_chars(first, last, value);
+        return res.ec == std::errc();
+    }
+}
+
+Utils::ParseStatus Utils::parse_event(std::string_view line, bool is_trade_file, Event &event)
+{
+    std::string_view tokens[CSV_FIELDS];
+    if (split_fields(line, tokens) < CSV_FIELDS)
+        return ParseStatus::CORRUPT;
+
+    uint64_t time_micro = 0, time_nano = 0;
+    if (!parse_int(tokens[1], time_micro) || !parse_int(tokens[6], time_nano))
+        return ParseStatus::CORRUPT;
+    event.timestamp = time_micro * 1000 + time_nano;
+
+    if (is_trade_file)
+    {
+        // TRADE FILE columns
+        // [7]=Order_No_B, [8]=Order_No_S, [9]=Token, [10]=Price, [11]=Quantity
+        event.type = EventType::TRADE;
+        if (!parse_int(tokens[7], event.buy_order_id) || !parse_int(tokens[8], event.sell_order_id) ||
+            !parse_int(tokens[9], event.token) || !parse_int(tokens[10], event.price) ||
+            !parse_int(tokens[11], event.quantity))
+            return ParseStatus::CORRUPT;
+        event.side = Side::BUY; // Not meaningful for trade itself
+        event.order_id = 0;     // No single relevant order in trade event
+    }
+    else
+    {
+        // ORDER FILE columns
+        // [5]=Order_Type
+        char order_type_char = tokens[5].empty() ? '\0' : tokens[5][0];
+        if (order_type_char == 'N')
+            event.type = EventType::NEW;
+        else if (order_type_char == 'M')
+            event.type = EventType::MODIFY;
+        else if (order_type_char == 'X')
+            event.type = EventType::CANCEL;
+        else if (order_type_char == 'T')
+            event.type = EventType::TRADE; // Sometimes present!
         else
-        {
-            // ORDER FILE columns
-            // [5]=Order_Type
-            char order_type_char = tokens[5][0];
-            if (order_type_char == 'N')
-                event.type = EventType::NEW;
-            else if (order_type_char == 'M')
-                event.type = EventType::MODIFY;
-            else if (order_type_char == 'X')
-                event.type = EventType::CANCEL;
-            else if (order_type_char == 'T')
-                event.type = EventType::TRADE; // Sometimes present!
-            else
-            {
-                std::cerr << "[parse_line] Unknown order type '" << order_type_char << "' in line: " << line << std::endl;
-                event.timestamp = 0;
-                return event;
-            }
-            event.order_id = std::stoull(tokens[7]);
-            event.token = std::stoull(tokens[8]);
-            event.side = (tokens[9] == "B") ? Side::BUY : Side::SELL;
-            event.price = std::stoi(tokens[10]);
-            event.quantity = std::stoi(tokens[11]);
+            return ParseStatus::UNKNOWN_TYPE;
+        if (!parse_int(tokens[7], event.order_id) || !parse_int(tokens[8], event.token) ||
+            !parse_int(tokens[10], event.price) || !parse_int(tokens[11], event.quantity))
+            return ParseStatus::CORRUPT;
+        event.side = (tokens[9] == "B") ? Side::BUY : Side::SELL;
+    }
+    return ParseStatus::OK;
+}
 
-            // For an in-order-file 'T' (TRADE) row, you may ALSO want to fill in buy_order_id, sell_order_id if you can.
-            if (order_type_char == 'T' && tokens.size() >= 9)
-            {
-                // Sometimes, you may want: event.buy_order_id = event.order_id;
-                // But without more info, can leave as is.
-            }
-        }
+Event Utils::parse_line(const std::string &line, bool is_trade_file)
+{
+    Event event;
+    ParseStatus status = parse_event(line, is_trade_file, event);
+    if (status == ParseStatus::CORRUPT)
+    {
+        Diagnostics::record(DiagReason::CORRUPT_LINE, 0, 0, 0, 0, 0, 0, line);
+        return Event();
     }
-    catch (const std::exception &e)
+    if (status == ParseStatus::UNKNOWN_TYPE)
     {
-        std::cerr << "[parse_line] parse error: " << e.what() << " for line: " << line << std::endl;
-        event.timestamp = 0;
+        Diagnostics::record(DiagReason::UNKNOWN_ORDER_TYPE, 0, 0, 0, 0, 0, 0, line);
+        return Event();
     }
     return event;
 }
 
 std::string Utils::format_timestamp_ist(uint64_t total_nanos)
 {
-    auto duration_ns = std::chrono::nanoseconds(total_nanos);
-    using clock = std::chrono::system_clock;
-    auto tp = clock::time_point(std::chrono::duration_cast<clock::duration>(duration_ns));
-    tp += std::chrono::hours(5) + std::chrono::minutes(30);
-    std::time_t time = clock::to_time_t(tp);
-    auto since_epoch = tp.time_since_epoch();
-    auto s = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
-    auto us = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch - s);
-
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time), "%H:%M:%S");
-    ss << '.' << std::setw(6) << std::setfill('0') << us.count();
+    char buf[TimestampFormatter::LENGTH + 1];
+    TimestampFormatter().format(total_nanos, buf);
+    return std::string(buf, TimestampFormatter::LENGTH);
+}
 
-    return ss.str();
+void Utils::TimestampFormatter::format(uint64_t total_nanos, char *out)
+{
+    const uint64_t IST_OFFSET_SECONDS = 5 * 3600 + 30 * 60;
+    uint64_t second = total_nanos / 1000000000ULL;
+    if (second != cached_second_)
+    {
+        uint64_t of_day = (second + IST_OFFSET_SECONDS) % 86400;
+        unsigned hh = static_cast<unsigned>(of_day / 3600);
+        unsigned mm = static_cast<unsigned>(of_day / 60 % 60);
+        unsigned ss = static_cast<unsigned>(of_day % 60);
+        prefix_[0] = static_cast<char>('0' + hh / 10);
+        prefix_[1] = static_cast<char>('0' + hh % 10);
+        prefix_[2] = ':';
+        prefix_[3] = static_cast<char>('0' + mm / 10);
+        prefix_[4] = static_cast<char>('0' + mm % 10);
+        prefix_[5] = ':';
+        prefix_[6] = static_cast<char>('0' + ss / 10);
+        prefix_[7] = static_cast<char>('0' + ss % 10);
+        prefix_[8] = '.';
+        cached_second_ = second;
+    }
+    std::memcpy(out, prefix_, sizeof(prefix_));
+    unsigned us = static_cast<unsigned>(total_nanos % 1000000000ULL / 1000);
+    for (int i = static_cast<int>(LENGTH) - 1; i >= 9; --i)
+    {
+        out[i] = static_cast<char>('0' + us % 10);
+        us /= 10;
+    }
+    out[LENGTH] = '\0';
 }
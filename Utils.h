@@ -3,16 +3,45 @@
 
 #include "DataTypes.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Utils
 {
+    enum class ParseStatus
+    {
+        OK,
+        CORRUPT,     // Too few fields or a malformed number
+        UNKNOWN_TYPE // Order row with an unrecognised Order_Type
+    };
+
+    // Allocation-free parse of one CSV row (no trailing newline) into event.
+    // Fields are tokenised in place and integers parsed with std::from_chars.
+    ParseStatus parse_event(std::string_view line, bool is_trade_file, Event &event);
+
     // Parses a CSV line into an Event
     Event parse_line(const std::string &line, bool is_trade_file);
 
     // Human-readable nanosecond timestamp > IST string
     std::string format_timestamp_ist(uint64_t total_nanos);
 
+    // Allocation-free IST formatter for hot paths. Keeps the "HH:MM:SS."
+    // prefix of the last whole second and only writes the microsecond digits
+    // while consecutive timestamps stay inside it. Not thread-safe; use one
+    // per thread or output stream.
+    class TimestampFormatter
+    {
+    public:
+        static constexpr size_t LENGTH = 15; // "HH:MM:SS.uuuuuu"
+
+        // Writes LENGTH chars plus a terminating NUL to out
+        void format(uint64_t total_nanos, char *out);
+
+    private:
+        uint64_t cached_second_ = UINT64_MAX;
+        char prefix_[9];
+    };
+
     // Fast string splitter for CSV
     std::vector<std::string> split(const std::string &s, char delimiter);
 }
@@ -0,0 +1,348 @@
+#include "Metrics.h"
+#include "OrderBook.h"
+#include "OrderFlow.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Micro and end-to-end benchmarks of the book and metrics hot paths on
+// seeded synthetic order flow; no input files needed. Every operation is
+// timed individually, so percentiles include one steady_clock read pair
+// (reported as timer_overhead_ns).
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    OrderFlowConfig flow;
+    size_t ops = 200000;    // timed operations per benchmark
+    size_t warm = 20000;    // passive orders resting before timing starts
+    std::string json_path;  // "-" for stdout
+    std::string filter;     // run only benchmarks whose name contains this
+};
+
+struct BenchResult
+{
+    std::string name;
+    size_t ops = 0;
+    double mean_ns = 0, p50_ns = 0, p90_ns = 0, p99_ns = 0, p999_ns = 0, max_ns = 0;
+};
+
+// Collects one duration per operation
+class Samples
+{
+public:
+    explicit Samples(size_t reserve) { ns_.reserve(reserve); }
+
+    template <typename F>
+    void time(F &&f)
+    {
+        Clock::time_point start = Clock::now();
+        f();
+        ns_.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+
+    BenchResult summarize(const std::string &name)
+    {
+        BenchResult r;
+        r.name = name;
+        r.ops = ns_.size();
+        if (ns_.empty())
+            return r;
+        double total = 0;
+        for (double ns : ns_)
+            total += ns;
+        std::sort(ns_.begin(), ns_.end());
+        r.mean_ns = total / ns_.size();
+        r.p50_ns = percentile(0.50);
+        r.p90_ns = percentile(0.90);
+        r.p99_ns = percentile(0.99);
+        r.p999_ns = percentile(0.999);
+        r.max_ns = ns_.back();
+        return r;
+    }
+
+private:
+    double percentile(double q) const { return ns_[static_cast<size_t>(q * (ns_.size() - 1))]; }
+
+    std::vector<double> ns_;
+};
+
+// A book holding warm passive orders from the generator
+void warm_book(OrderBook &book, OrderFlowGenerator &gen, size_t warm)
+{
+    for (size_t i = 0; i < warm; ++i)
+        book.process_event(gen.passive_add());
+}
+
+BenchResult bench_add(const BenchOptions &opts)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm);
+    std::vector<Event> adds;
+    for (size_t i = 0; i < opts.ops; ++i)
+        adds.push_back(gen.passive_add());
+    Samples samples(opts.ops);
+    for (const Event &e : adds)
+        samples.time([&]
+                     { book.process_event(e); });
+    return samples.summarize("add_order");
+}
+
+BenchResult bench_cancel(const BenchOptions &opts)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm + opts.ops);
+    std::vector<Event> cancels;
+    for (size_t i = 0; i < opts.ops; ++i)
+        cancels.push_back(gen.cancel());
+    Samples samples(opts.ops);
+    for (const Event &e : cancels)
+        samples.time([&]
+                     { book.process_event(e); });
+    return samples.summarize("cancel_order");
+}
+
+BenchResult bench_modify(const BenchOptions &opts)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm);
+    std::vector<Event> modifies;
+    for (size_t i = 0; i < opts.ops; ++i)
+        modifies.push_back(gen.modify());
+    Samples samples(opts.ops);
+    for (const Event &e : modifies)
+        samples.time([&]
+                     { book.process_event(e); });
+    return samples.summarize("modify_order");
+}
+
+// Marketable orders; the levels they take are refilled untimed afterwards
+BenchResult bench_aggressive(const BenchOptions &opts)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm);
+    Samples samples(opts.ops);
+    for (size_t i = 0; i < opts.ops; ++i)
+    {
+        Event e = gen.aggressive_add();
+        size_t before = book.order_count(Side::BUY) + book.order_count(Side::SELL);
+        samples.time([&]
+                     { book.process_event(e); });
+        size_t after = book.order_count(Side::BUY) + book.order_count(Side::SELL);
+        for (size_t n = after; n < before + 1; ++n)
+            book.process_event(gen.passive_add());
+    }
+    return samples.summarize("aggressive_match");
+}
+
+BenchResult bench_depth(const BenchOptions &opts)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm);
+    std::pair<int, int> bids[10], asks[10];
+    int sink = 0;
+    Samples samples(opts.ops);
+    for (size_t i = 0; i < opts.ops; ++i)
+        samples.time([&]
+                     { sink += book.get_bids_depth(bids, 10) + book.get_asks_depth(asks, 10); });
+    if (sink < 0)
+        std::cerr << sink;
+    return samples.summarize("depth_query_10");
+}
+
+BenchResult bench_calculate(const BenchOptions &opts)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm);
+    double sink = 0;
+    Samples samples(opts.ops);
+    for (size_t i = 0; i < opts.ops; ++i)
+        samples.time([&]
+                     { sink += MetricsCalculator::calculate(book, i, 5, 0.5, false).ofi_depth; });
+    if (sink != sink)
+        std::cerr << sink;
+    return samples.summarize("metrics_calculate");
+}
+
+// Mixed flow: apply each event and compute its metrics row
+BenchResult bench_end_to_end(const BenchOptions &opts, bool incremental)
+{
+    OrderBook book;
+    OrderFlowGenerator gen(opts.flow);
+    warm_book(book, gen, opts.warm);
+    std::vector<Event> events = gen.generate(opts.ops);
+    IncrementalMetricsCalculator calc(book, 5, 0.5);
+    double sink = 0;
+    Samples samples(opts.ops);
+    for (const Event &e : events)
+    {
+        if (incremental)
+            samples.time([&]
+                         { book.process_event(e); sink += calc.calculate(e.timestamp, false).ofi_depth; });
+        else
+            samples.time([&]
+                         { book.process_event(e); sink += MetricsCalculator::calculate(book, e.timestamp, 5, 0.5, false).ofi_depth; });
+    }
+    if (sink != sink)
+        std::cerr << sink;
+    return samples.summarize(incremental ? "end_to_end_incremental" : "end_to_end");
+}
+
+double timer_overhead_ns()
+{
+    Samples samples(100000);
+    for (int i = 0; i < 100000; ++i)
+        samples.time([] {});
+    return samples.summarize("timer").p50_ns;
+}
+
+void write_json(std::ostream &os, const BenchOptions &opts, double overhead, const std::vector<BenchResult> &results)
+{
+    const OrderFlowConfig &f = opts.flow;
+    os << std::fixed << std::setprecision(1);
+    os << "{\n  \"config\": {\"seed\": " << f.seed << ", \"ops\": " << opts.ops << ", \"warm\": " << opts.warm
+       << ", \"depth_ticks\": " << f.depth_ticks << ", \"add_ratio\": " << f.add_ratio
+       << ", \"cancel_ratio\": " << f.cancel_ratio << ", \"modify_ratio\": " << f.modify_ratio
+       << ", \"aggressive_ratio\": " << f.aggressive_ratio << "},\n";
+    os << "  \"timer_overhead_ns\": " << overhead << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult &r = results[i];
+        os << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops << ", \"mean_ns\": " << r.mean_ns
+           << ", \"p50_ns\": " << r.p50_ns << ", \"p90_ns\": " << r.p90_ns << ", \"p99_ns\": " << r.p99_ns
+           << ", \"p999_ns\": " << r.p999_ns << ", \"max_ns\": " << r.max_ns << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+void print_usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --seed N            generator seed (default 42)\n"
+              << "  --ops N             timed operations per benchmark (default 200000)\n"
+              << "  --warm N            resting orders before timing (default 20000)\n"
+              << "  --depth-ticks N     passive price range around the mid (default 50)\n"
+              << "  --add R --cancel R --modify R --aggressive R\n"
+              << "                      event mix weights for the end-to-end runs\n"
+              << "  --filter NAME       only benchmarks whose name contains NAME\n"
+              << "  --json PATH         also write results as JSON (- for stdout)\n";
+}
+
+bool parse_args(int argc, char **argv, BenchOptions &opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+        const char *value = argv[++i];
+        if (std::strcmp(arg, "--seed") == 0)
+            opts.flow.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--ops") == 0)
+            opts.ops = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--warm") == 0)
+            opts.warm = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--depth-ticks") == 0)
+            opts.flow.depth_ticks = std::atoi(value);
+        else if (std::strcmp(arg, "--add") == 0)
+            opts.flow.add_ratio = std::atof(value);
+        else if (std::strcmp(arg, "--cancel") == 0)
+            opts.flow.cancel_ratio = std::atof(value);
+        else if (std::strcmp(arg, "--modify") == 0)
+            opts.flow.modify_ratio = std::atof(value);
+        else if (std::strcmp(arg, "--aggressive") == 0)
+            opts.flow.aggressive_ratio = std::atof(value);
+        else if (std::strcmp(arg, "--filter") == 0)
+            opts.filter = value;
+        else if (std::strcmp(arg, "--json") == 0)
+            opts.json_path = value;
+        else
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opts;
+    if (!parse_args(argc, argv, opts))
+        return 1;
+
+    struct Bench
+    {
+        const char *name;
+        std::function<BenchResult()> run;
+    };
+    std::vector<Bench> benches = {
+        {"add_order", [&]
+         { return bench_add(opts); }},
+        {"cancel_order", [&]
+         { return bench_cancel(opts); }},
+        {"modify_order", [&]
+         { return bench_modify(opts); }},
+        {"aggressive_match", [&]
+         { return bench_aggressive(opts); }},
+        {"depth_query_10", [&]
+         { return bench_depth(opts); }},
+        {"metrics_calculate", [&]
+         { return bench_calculate(opts); }},
+        {"end_to_end", [&]
+         { return bench_end_to_end(opts, false); }},
+        {"end_to_end_incremental", [&]
+         { return bench_end_to_end(opts, true); }},
+    };
+
+    double overhead = timer_overhead_ns();
+    std::cout << "lob_bench: seed " << opts.flow.seed << ", " << opts.ops << " ops, " << opts.warm
+              << " warm orders, timer overhead " << std::fixed << std::setprecision(1) << overhead << " ns\n";
+    std::cout << std::left << std::setw(24) << "benchmark" << std::right << std::setw(10) << "mean" << std::setw(10)
+              << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+              << std::setw(12) << "max (ns)\n";
+
+    std::vector<BenchResult> results;
+    for (const Bench &bench : benches)
+    {
+        if (!opts.filter.empty() && std::string(bench.name).find(opts.filter) == std::string::npos)
+            continue;
+        BenchResult r = bench.run();
+        std::cout << std::left << std::setw(24) << r.name << std::right << std::setw(10) << r.mean_ns
+                  << std::setw(10) << r.p50_ns << std::setw(10) << r.p90_ns << std::setw(10) << r.p99_ns
+                  << std::setw(10) << r.p999_ns << std::setw(11) << r.max_ns << "\n";
+        results.push_back(r);
+    }
+
+    if (opts.json_path == "-")
+        write_json(std::cout, opts, overhead, results);
+    else if (!opts.json_path.empty())
+    {
+        std::ofstream out(opts.json_path);
+        if (!out)
+        {
+            std::cerr << "FATAL ERROR: Could not open " << opts.json_path << std::endl;
+            return 1;
+        }
+        write_json(out, opts, overhead, results);
+    }
+    return 0;
+}
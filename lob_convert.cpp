@@ -0,0 +1,55 @@
+#include "EventFile.h"
+#include "Ingest.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Parses the NSE order/trade CSVs once and writes a timestamp-sorted binary
+// capture that lob_sim --input-bin can replay without any parsing.
+int main(int argc, char **argv)
+{
+    std::string order_filepath = "Data/nse_orders_data.csv";
+    std::string trade_filepath = "Data/nse_trades_data.csv";
+    std::string output_filepath = "Data/nse_events.lobevt";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--orders") == 0 && has_value)
+            order_filepath = argv[++i];
+        else if (std::strcmp(argv[i], "--trades") == 0 && has_value)
+            trade_filepath = argv[++i];
+        else if (std::strcmp(argv[i], "--output") == 0 && has_value)
+            output_filepath = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--orders PATH] [--trades PATH] [--output PATH]\n";
+            return 1;
+        }
+    }
+
+    EventStore events;
+    IngestStats stats;
+    {
+        ThreadPool pool;
+        std::string failed_path;
+        if (!Ingest::load_sorted({{order_filepath, false}, {trade_filepath, true}}, pool, events, stats, failed_path))
+        {
+            std::cerr << "FATAL ERROR: Could not open input file at " << failed_path << std::endl;
+            return 1;
+        }
+    }
+    if (stats.corrupt + stats.unknown_type > 0)
+        stats.report(std::cerr);
+
+    std::string error;
+    if (!EventFile::write(output_filepath, events, error))
+    {
+        std::cerr << "FATAL ERROR: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << events.size() << " events to " << output_filepath << std::endl;
+    return 0;
+}
@@ -0,0 +1,359 @@
+#include "Checkpoint.h"
+#include "L2Feed.h"
+#include "Metrics.h"
+#include "MetricsEmitter.h"
+#include "OrderBook.h"
+#include "OrderFlow.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Behaviour checks on seeded synthetic flow; run by ctest. Each test prints
+// its first few failures and the process exits non-zero if any test failed.
+
+namespace
+{
+    const int DEPTH_LEVELS = 5;
+    const double DECAY_LAMBDA = 0.5;
+    const size_t MAX_REPORTED = 5;
+
+    class Test
+    {
+    public:
+        explicit Test(const char *name) : name_(name) {}
+
+        void check(bool ok, const std::string &what)
+        {
+            if (ok)
+                return;
+            if (failures_++ < MAX_REPORTED)
+                std::cerr << "  " << name_ << ": " << what << "\n";
+        }
+
+        bool finish() const
+        {
+            std::cout << (failures_ == 0 ? "PASS " : "FAIL ") << name_;
+            if (failures_ > 0)
+                std::cout << " (" << failures_ << " failure(s))";
+            std::cout << "\n";
+            return failures_ == 0;
+        }
+
+    private:
+        const char *name_;
+        size_t failures_ = 0;
+    };
+
+    Event order(EventType type, uint64_t order_id, int price, int quantity, Side side, uint64_t timestamp)
+    {
+        return Event(timestamp, type, order_id, price, quantity, side);
+    }
+
+    bool same_metrics(const LOBMetrics &a, const LOBMetrics &b)
+    {
+        return a.mid_price == b.mid_price && a.spread == b.spread && a.ofi_top == b.ofi_top &&
+               a.ofi_depth == b.ofi_depth && a.depth_bids == b.depth_bids && a.depth_asks == b.depth_asks;
+    }
+
+    // Full-recompute reference: depth copied out of the book, then the
+    // stateless formula
+    LOBMetrics from_depth(const OrderBook &book, int depth_levels)
+    {
+        std::vector<std::pair<int, int>> bids(depth_levels), asks(depth_levels);
+        int n_bids = book.get_bids_depth(bids.data(), depth_levels);
+        int n_asks = book.get_asks_depth(asks.data(), depth_levels);
+        std::vector<int> bid_qty(depth_levels), ask_qty(depth_levels);
+        for (int i = 0; i < n_bids; ++i)
+            bid_qty[i] = bids[i].second;
+        for (int i = 0; i < n_asks; ++i)
+            ask_qty[i] = asks[i].second;
+        LOBMetrics metrics;
+        MetricsCalculator::calculate_from_depth(metrics, n_bids > 0 ? bids[0].first : 0, n_asks > 0 ? asks[0].first : 0,
+                                                bid_qty.data(), n_bids, ask_qty.data(), n_asks, depth_levels, DECAY_LAMBDA);
+        return metrics;
+    }
+
+    bool same_ohlc(const Ohlc &a, const Ohlc &b)
+    {
+        return a.open == b.open && a.high == b.high && a.low == b.low && a.close == b.close;
+    }
+
+    std::vector<char> saved_state(const OrderBook &book)
+    {
+        CheckpointWriter out;
+        book.save_state(out);
+        return out.data();
+    }
+
+    bool test_incremental_metrics()
+    {
+        Test t("incremental_metrics_match_full_recompute");
+        for (int depth : {1, DEPTH_LEVELS, 20})
+        {
+            OrderFlowConfig flow;
+            flow.seed = 7 + depth;
+            OrderFlowGenerator gen(flow);
+            OrderBook book;
+            IncrementalMetricsCalculator calc(book, depth, DECAY_LAMBDA);
+            for (int i = 0; i < 50000; ++i)
+            {
+                Event event = gen.next();
+                book.process_event(event);
+                const LOBMetrics &row = calc.calculate(event.timestamp, false);
+                t.check(same_metrics(row, from_depth(book, depth)),
+                        "depth " + std::to_string(depth) + ": event " + std::to_string(i) + " differs");
+            }
+        }
+        return t.finish();
+    }
+
+    bool test_modify_priority()
+    {
+        Test t("same_price_reduce_keeps_queue_position");
+        {
+            // A reduce keeps A ahead of B, so the sell fills A alone
+            OrderBook book;
+            book.process_event(order(EventType::NEW, 1, 100, 10, Side::BUY, 1));
+            book.process_event(order(EventType::NEW, 2, 100, 10, Side::BUY, 2));
+            book.process_event(order(EventType::MODIFY, 1, 100, 4, Side::BUY, 3));
+            book.process_event(order(EventType::NEW, 3, 100, 4, Side::SELL, 4));
+            book.process_event(order(EventType::CANCEL, 2, 100, 0, Side::BUY, 5));
+            t.check(book.level_count(Side::BUY) == 0, "reduced order lost its place in the queue");
+        }
+        {
+            // An increase goes to the back, so the sell fills B first
+            OrderBook book;
+            book.process_event(order(EventType::NEW, 1, 100, 10, Side::BUY, 1));
+            book.process_event(order(EventType::NEW, 2, 100, 10, Side::BUY, 2));
+            book.process_event(order(EventType::MODIFY, 1, 100, 15, Side::BUY, 3));
+            book.process_event(order(EventType::NEW, 3, 100, 10, Side::SELL, 4));
+            std::vector<std::pair<int, int>> bids = book.get_bids_depth(1);
+            t.check(book.order_count(Side::BUY) == 1 && bids.size() == 1 && bids[0].second == 15,
+                    "increased order kept its place in the queue");
+        }
+        return t.finish();
+    }
+
+    bool test_self_trade_index()
+    {
+        Test t("self_trade_index_follows_resting_orders");
+        OrderBook book;
+        Event sell = order(EventType::NEW, 1, 101, 5, Side::SELL, 1);
+        sell.user_id = 7;
+        book.process_event(sell);
+        Event buy = order(EventType::NEW, 2, 101, 5, Side::BUY, 2);
+        buy.user_id = 7;
+        t.check(book.would_self_trade(buy), "resting own ask not seen");
+        book.process_event(order(EventType::CANCEL, 1, 101, 0, Side::SELL, 3));
+        t.check(!book.would_self_trade(buy), "cancelled own ask still seen");
+        // The user left the index with their last order and comes back
+        sell.order_id = 3;
+        book.process_event(sell);
+        t.check(book.would_self_trade(buy), "own ask after re-entry not seen");
+        book.process_event(buy);
+        t.check(book.stp_stats().incoming_cancelled == 1 && book.order_count(Side::SELL) == 1,
+                "self trade after re-entry was not prevented");
+        return t.finish();
+    }
+
+    bool test_trade_reconciliation()
+    {
+        Test t("trades_count_only_when_a_resting_order_fills");
+        OrderBookConfig config;
+        config.matching = MatchingMode::TRADE_DRIVEN;
+        OrderBook book(config);
+        book.process_event(order(EventType::NEW, 1, 100, 10, Side::BUY, 1));
+        book.process_event(Event(2, EventType::TRADE, 0, 100, 4, Side::BUY, 0, 1, 9));
+        book.process_event(Event(3, EventType::TRADE, 0, 100, 4, Side::BUY, 0, 8, 9));
+        book.process_event(Event(4, EventType::TRADE, 0, 100, 4, Side::BUY, 0, 0, 0));
+        const ReconcileStats &rec = book.reconcile_stats();
+        t.check(rec.trades == 1, "expected one matched trade, got " + std::to_string(rec.trades));
+        t.check(rec.unmatched_trades == 1, "expected one unmatched trade, got " + std::to_string(rec.unmatched_trades));
+        t.check(rec.anonymous_trades == 1, "expected one id-less trade, got " + std::to_string(rec.anonymous_trades));
+        t.check(rec.fills == 1 && rec.unknown_order == 3, "fill or unknown order counts wrong");
+        std::vector<std::pair<int, int>> bids = book.get_bids_depth(1);
+        t.check(bids.size() == 1 && bids[0].second == 6, "matched trade did not reduce the resting order");
+        return t.finish();
+    }
+
+    bool test_checkpoint_round_trip()
+    {
+        Test t("save_state_load_state_reproduces_book");
+        OrderFlowGenerator gen;
+        OrderBook original;
+        for (int i = 0; i < 20000; ++i)
+            original.process_event(gen.next());
+        original.take_snapshot(1);
+
+        std::vector<char> state = saved_state(original);
+        OrderBook restored;
+        CheckpointReader in(state.data(), state.size());
+        t.check(restored.load_state(in) && in.remaining() == 0, "load_state rejected its own state");
+        t.check(saved_state(restored) == state, "restored book saves different state");
+        t.check(restored.get_snapshots().size() == original.get_snapshots().size(), "snapshot ring not restored");
+
+        // Same queues: identical follow-on flow keeps the books identical
+        for (int i = 0; i < 20000; ++i)
+        {
+            Event event = gen.next();
+            original.process_event(event);
+            restored.process_event(event);
+        }
+        t.check(saved_state(restored) == saved_state(original), "books diverged after the restore");
+        t.check(restored.get_bids_depth(1000) == original.get_bids_depth(1000) &&
+                    restored.get_asks_depth(1000) == original.get_asks_depth(1000),
+                "depth diverged after the restore");
+
+        // First bid level's price, right after the level count
+        std::vector<char> bad = saved_state(original);
+        int32_t negative = -1;
+        std::memcpy(bad.data() + sizeof(uint32_t), &negative, sizeof(negative));
+        CheckpointReader bad_in(bad.data(), bad.size());
+        OrderBook rejected;
+        t.check(!rejected.load_state(bad_in) && rejected.level_count(Side::BUY) == 0, "negative price accepted");
+        return t.finish();
+    }
+
+    template <typename Map>
+    bool same_levels(const Map &replica, const std::vector<std::pair<int, int>> &book)
+    {
+        if (replica.size() != book.size())
+            return false;
+        size_t i = 0;
+        for (const auto &level : replica)
+            if (level.first != book[i].first || level.second != book[i++].second)
+                return false;
+        return true;
+    }
+
+    bool test_l2_feed()
+    {
+        Test t("l2_replica_follows_book_and_recovers_from_gaps");
+        OrderFlowGenerator gen;
+        OrderBook book;
+        L2FeedPublisher publisher(book, 1, 500);
+        L2BookReplica replica;
+        std::vector<L2Record> records;
+        uint64_t last_sequence = 0;
+        bool dropped = false;
+        bool unseen_gap = false; // a loss only shows on the next record
+        for (int i = 0; i < 20000; ++i)
+        {
+            Event event = gen.next();
+            book.process_event(event);
+            records.clear();
+            publisher.publish(event.timestamp, records);
+            for (size_t r = 0; r < records.size(); ++r)
+            {
+                t.check(records[r].sequence == last_sequence + 1, "sequence not consecutive at event " + std::to_string(i));
+                last_sequence = records[r].sequence;
+                // Lose one delta mid-run
+                if (!dropped && i > 5000 && records[r].type == L2RecordType::DELTA)
+                {
+                    dropped = unseen_gap = true;
+                    continue;
+                }
+                replica.apply(records[r]);
+                if (replica.gaps() > 0)
+                    unseen_gap = false;
+            }
+            if (replica.synced() && !unseen_gap)
+                t.check(same_levels(replica.bids(), book.get_bids_depth(1 << 16)) &&
+                            same_levels(replica.asks(), book.get_asks_depth(1 << 16)),
+                        "replica differs from the book at event " + std::to_string(i));
+        }
+        t.check(dropped && replica.gaps() == 1, "lost delta not detected");
+        t.check(replica.synced(), "replica did not resync on a refresh");
+        return t.finish();
+    }
+
+    bool test_emitter_windows()
+    {
+        Test t("interval_emitter_matches_per_event_metrics");
+        EmitConfig last_config, ohlc_config;
+        last_config.mode = ohlc_config.mode = EmitMode::INTERVAL;
+        last_config.interval_ns = ohlc_config.interval_ns = 50000; // 50 events at the default step
+        ohlc_config.aggregation = BucketAggregation::OHLC;
+
+        OrderFlowGenerator gen;
+        OrderBook book;
+        MetricsEmitter last(book, 1, last_config, DEPTH_LEVELS, DECAY_LAMBDA);
+        MetricsEmitter ohlc(book, 1, ohlc_config, DEPTH_LEVELS, DECAY_LAMBDA);
+        LOBMetrics before; // the book as of the previous event
+        MetricsBar expected;
+        uint64_t window = UINT64_MAX;
+        size_t windows = 0, rows = 0, bars = 0;
+
+        auto check_closed = [&](MetricsEmitter::Emitted row, MetricsEmitter::Emitted bar)
+        {
+            t.check(row == MetricsEmitter::Emitted::ROW && bar == MetricsEmitter::Emitted::BAR, "window did not close");
+            if (row != MetricsEmitter::Emitted::ROW || bar != MetricsEmitter::Emitted::BAR)
+                return;
+            ++rows;
+            ++bars;
+            t.check(same_metrics(last.row(), before) && last.row().timestamp_raw == expected.timestamp_raw,
+                    "last-value row is not the window's final state");
+            const MetricsBar &got = ohlc.bar();
+            t.check(got.timestamp_raw == expected.timestamp_raw && got.events == expected.events &&
+                        same_ohlc(got.mid_price, expected.mid_price) && same_ohlc(got.spread, expected.spread) &&
+                        same_ohlc(got.ofi_top, expected.ofi_top) && same_ohlc(got.ofi_depth, expected.ofi_depth),
+                    "bar differs from the window's per-event metrics");
+        };
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            Event event = gen.next();
+            uint64_t event_window = event.timestamp / ohlc_config.interval_ns;
+            MetricsEmitter::Emitted row = last.before_event(event);
+            MetricsEmitter::Emitted bar = ohlc.before_event(event);
+            if (window != UINT64_MAX && event_window != window)
+                check_closed(row, bar);
+            else
+                t.check(row == MetricsEmitter::Emitted::NOTHING && bar == MetricsEmitter::Emitted::NOTHING,
+                        "window closed early");
+
+            book.process_event(event);
+            t.check(last.after_event(event, i) == MetricsEmitter::Emitted::NOTHING &&
+                        ohlc.after_event(event, i) == MetricsEmitter::Emitted::NOTHING,
+                    "interval emitter emitted mid-window");
+            before = MetricsCalculator::calculate(book, event.timestamp, DEPTH_LEVELS, DECAY_LAMBDA, false);
+            if (event_window != window)
+            {
+                window = event_window;
+                ++windows;
+                expected = MetricsBar();
+                expected.timestamp_raw = window * ohlc_config.interval_ns;
+                expected.token = 1;
+                expected.mid_price.start(before.mid_price);
+                expected.spread.start(before.spread);
+                expected.ofi_top.start(before.ofi_top);
+                expected.ofi_depth.start(before.ofi_depth);
+            }
+            else
+            {
+                expected.mid_price.add(before.mid_price);
+                expected.spread.add(before.spread);
+                expected.ofi_top.add(before.ofi_top);
+                expected.ofi_depth.add(before.ofi_depth);
+            }
+            ++expected.events;
+        }
+        check_closed(last.finish(), ohlc.finish());
+        t.check(rows == windows && bars == windows, "expected one row and bar per window");
+        return t.finish();
+    }
+}
+
+int main()
+{
+    bool ok = true;
+    ok &= test_incremental_metrics();
+    ok &= test_modify_priority();
+    ok &= test_self_trade_index();
+    ok &= test_trade_reconciliation();
+    ok &= test_checkpoint_round_trip();
+    ok &= test_l2_feed();
+    ok &= test_emitter_windows();
+    return ok ? 0 : 1;
+}
@@ -1,150 +1,1076 @@
-#include "OrderBook.h"
+#include "BatchRunner.h"
+#include "BookManager.h"
+#include "Diagnostics.h"
+#include "EventFile.h"
+#include "EventStream.h"
+#include "Ingest.h"
+#include "L2Feed.h"
 #include "Metrics.h"
+#include "MetricsEmitter.h"
+#include "MetricsWriter.h"
+#include "Pipeline.h"
+#include "ShmTopOfBook.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 
 #if __cplusplus >= 201703L
 #include <filesystem>
 namespace fs = std::filesystem;
 #endif
 
-void print_depth(const std::vector<std::pair<int, int>> &bids, const std::vector<std::pair<int, int>> &asks)
+void print_depth(std::ostream &os, const std::vector<std::pair<int, int>> &bids, const std::vector<std::pair<int, int>> &asks)
 {
-    std::cout << "BIDS (Price/Qty)           | ASKS (Price/Qty)\n";
-    std::cout << "-------------------------- | -------------------------\n";
+    os << "BIDS (Price/Qty)           | ASKS (Price/Qty)\n";
+    os << "-------------------------- | -------------------------\n";
     for (int i = 0; i < 10; ++i)
     {
         if (i < bids.size())
         {
-            std::cout << std::fixed << std::setprecision(2) << std::setw(10) << bids[i].first / 100.0
-                      << "/" << std::setw(12) << bids[i].second << " | ";
+            os << std::fixed << std::setprecision(2) << std::setw(10) << bids[i].first / 100.0
+               << "/" << std::setw(12) << bids[i].second << " | ";
         }
         else
         {
-            std::cout << std::string(26, ' ') << "| ";
+            os << std::string(26, ' ') << "| ";
         }
         if (i < asks.size())
         {
-            std::cout << std::fixed << std::setprecision(2) << std::setw(10) << asks[i].first / 100.0
-                      << "/" << std::setw(12) << asks[i].second;
+            os << std::fixed << std::setprecision(2) << std::setw(10) << asks[i].first / 100.0
+               << "/" << std::setw(12) << asks[i].second;
         }
-        std::cout << "\n";
+        os << "\n";
     }
 }
 
-int main()
+struct SimOptions
 {
-    // Updated file paths for your folder structure
+    std::string output_path() const
+    {
+        if (!metrics_filepath.empty())
+            return metrics_filepath;
+        return output_format == OutputFormat::NPY ? "Output/metrics_columns" : "Output/metrics_output.csv";
+    }
+
     std::string order_filepath = "Data/nse_orders_data.csv";
     std::string trade_filepath = "Data/nse_trades_data.csv";
-    std::string metrics_filepath = "Output/metrics_output.csv";
+    std::string metrics_filepath;         // Defaults per format, see output_path()
+    OutputFormat output_format = OutputFormat::CSV;
+    std::string input_bin_filepath;       // Replay a lob_convert capture instead of the CSVs
+    bool streaming = false;               // Read and replay incrementally instead of loading everything
+    uint64_t reorder_window_ns = 1000000; // Streaming: tolerated out-of-order distance within a file
+    bool verify_metrics = false;          // Cross-check incremental metrics against a full recompute
+    bool pipeline = false;                // Streaming: run ingest, book, metrics and output as threaded stages
+    bool trade_driven = false;            // Fill resting orders from the trade file instead of matching internally
+    std::string l2_feed_filepath;         // Write an L2 delta feed here when set
+    uint64_t l2_refresh_events = L2FeedPublisher::DEFAULT_REFRESH_INTERVAL;
+    std::string shm_name;                 // Publish each token's book top to this shared-memory segment
+    uint64_t shm_every = 1;               // Events per token between shared-memory publishes
+    uint32_t shm_max_tokens = 256;
+    uint64_t checkpoint_every = 0;          // Streaming: checkpoint every N events consumed (0 = off)
+    std::vector<uint64_t> checkpoint_at;    // Streaming: checkpoint once all events up to each raw timestamp are applied
+    std::string checkpoint_dir = "Output";
+    std::string restore_filepath;           // Streaming: resume from this checkpoint
+    size_t replay_workers = 0;              // Ingest and token replay threads (0 = hardware concurrency)
+    std::string manifest_filepath;          // Batch of days: orders,trades,output per line
+    std::string batch_glob;                 // Batch of days: order files matching this pattern
+    std::string batch_output_dir = "Output";
+    size_t batch_jobs = 0;                  // Days replayed at once (0 = hardware concurrency)
+    uint64_t batch_memory_mb = 0;           // Estimated resident memory cap across running days (0 = none)
+    EmitConfig emit;                        // Which events produce metrics rows (default: all)
 
-#if __cplusplus >= 201703L
-    // Create the Output directory if it does not exist (C++17 only)
-    if (!fs::exists("Output"))
-        fs::create_directory("Output");
+    bool batch() const { return !manifest_filepath.empty() || !batch_glob.empty(); }
+};
+
+void print_usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --orders PATH           order file (default Data/nse_orders_data.csv)\n"
+              << "  --trades PATH           trade file (default Data/nse_trades_data.csv)\n"
+              << "  --output PATH           metrics CSV, or directory for npy (default Output/metrics_output.csv\n"
+              << "                          or Output/metrics_columns)\n"
+              << "  --format csv|npy        metrics output format (default csv)\n"
+              << "  --input-bin PATH        replay a binary capture written by lob_convert\n"
+              << "  --stream                bounded-memory streaming replay\n"
+              << "  --reorder-window-ns N   streaming reorder window (default 1000000)\n"
+              << "  --pipeline              stream through threaded ingest/book/metrics/output stages\n"
+              << "  --trade-driven          apply the exchange's trades instead of matching crossing orders\n"
+              << "  --verify-metrics        recompute every row from scratch and count mismatches\n"
+              << "  --l2-feed PATH          write market-by-price level deltas to PATH\n"
+              << "  --l2-refresh N          events per token between full L2 refreshes (default 10000)\n"
+              << "  --shm NAME              publish top-of-book to POSIX shared memory /NAME\n"
+              << "  --shm-every N           events per token between shared-memory publishes (default 1)\n"
+              << "  --shm-tokens N          shared-memory slots, one per token (default 256)\n"
+              << "  --checkpoint-every N    write a book checkpoint every N events (implies --stream)\n"
+              << "  --checkpoint-at TS      write a checkpoint once every event up to raw timestamp TS is applied;\n"
+              << "                          repeatable (implies --stream)\n"
+              << "  --checkpoint-dir DIR    directory for checkpoint files (default Output)\n"
+              << "  --restore PATH          resume from a checkpoint, skipping the input it covers (implies --stream);\n"
+              << "                          --input-bin captures seek straight there, CSV input is re-parsed up to it.\n"
+              << "                          Rows are appended to --output, which must hold the run the checkpoint\n"
+              << "                          came from; rows after the checkpoint are replaced\n"
+              << "  --manifest PATH         replay many days: one orders,trades,output triple per line\n"
+              << "  --batch-glob PATTERN    replay every order file matching PATTERN with its trades file\n"
+              << "  --batch-output DIR      output directory for --batch-glob (default Output)\n"
+              << "  --jobs N                days replayed concurrently (default: hardware threads)\n"
+              << "  --batch-memory-mb N     cap on the estimated memory of the days in flight\n"
+              << "  --emit-interval-ns N    one row per token per N ns of exchange time, instead of per event\n"
+              << "  --emit-agg last|ohlc    interval rows hold the last book state (default) or OHLC bars of\n"
+              << "                          mid, spread and OFI\n"
+              << "  --emit-every N          one row per token every N of its events\n"
+              << "  --emit-on-top-change    a row only when the best bid or ask price or size changes\n";
+}
+
+// Whole-string unsigned decimal; strtoull alone reads "1ms" as 1 and "-1"
+// as a huge count
+bool parse_count(const char *option, const char *text, uint64_t &value)
+{
+    char *end = nullptr;
+    errno = 0;
+    if (std::isdigit(static_cast<unsigned char>(text[0])))
+        value = std::strtoull(text, &end, 10);
+    if (end == nullptr || *end != '\0' || errno == ERANGE)
+    {
+        std::cerr << option << " needs a non-negative integer, got \"" << text << "\"\n";
+        return false;
+    }
+    return true;
+}
+
+bool parse_args(int argc, char **argv, SimOptions &opts)
+{
+    int emit_modes = 0;
+    uint64_t n = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--orders") == 0 && has_value)
+            opts.order_filepath = argv[++i];
+        else if (std::strcmp(arg, "--trades") == 0 && has_value)
+            opts.trade_filepath = argv[++i];
+        else if (std::strcmp(arg, "--output") == 0 && has_value)
+            opts.metrics_filepath = argv[++i];
+        else if (std::strcmp(arg, "--format") == 0 && has_value && std::strcmp(argv[i + 1], "csv") == 0)
+        {
+            opts.output_format = OutputFormat::CSV;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--format") == 0 && has_value && std::strcmp(argv[i + 1], "npy") == 0)
+        {
+            opts.output_format = OutputFormat::NPY;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--input-bin") == 0 && has_value)
+            opts.input_bin_filepath = argv[++i];
+        else if (std::strcmp(arg, "--stream") == 0)
+            opts.streaming = true;
+        else if (std::strcmp(arg, "--reorder-window-ns") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.reorder_window_ns = n;
+        }
+        else if (std::strcmp(arg, "--pipeline") == 0)
+            opts.streaming = opts.pipeline = true;
+        else if (std::strcmp(arg, "--trade-driven") == 0)
+            opts.trade_driven = true;
+        else if (std::strcmp(arg, "--verify-metrics") == 0)
+            opts.verify_metrics = true;
+        else if (std::strcmp(arg, "--l2-feed") == 0 && has_value)
+            opts.l2_feed_filepath = argv[++i];
+        else if (std::strcmp(arg, "--l2-refresh") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.l2_refresh_events = n;
+        }
+        else if (std::strcmp(arg, "--shm") == 0 && has_value)
+            opts.shm_name = argv[++i];
+        else if (std::strcmp(arg, "--shm-every") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.shm_every = std::max<uint64_t>(1, n);
+        }
+        else if (std::strcmp(arg, "--shm-tokens") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            if (n > UINT32_MAX)
+            {
+                std::cerr << "--shm-tokens is at most " << UINT32_MAX << "\n";
+                return false;
+            }
+            opts.shm_max_tokens = static_cast<uint32_t>(n);
+        }
+        else if (std::strcmp(arg, "--checkpoint-every") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.checkpoint_every = n;
+            opts.streaming = true;
+        }
+        else if (std::strcmp(arg, "--checkpoint-at") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.checkpoint_at.push_back(n);
+            opts.streaming = true;
+        }
+        else if (std::strcmp(arg, "--checkpoint-dir") == 0 && has_value)
+            opts.checkpoint_dir = argv[++i];
+        else if (std::strcmp(arg, "--restore") == 0 && has_value)
+        {
+            opts.restore_filepath = argv[++i];
+            opts.streaming = true;
+        }
+        else if (std::strcmp(arg, "--manifest") == 0 && has_value)
+            opts.manifest_filepath = argv[++i];
+        else if (std::strcmp(arg, "--batch-glob") == 0 && has_value)
+            opts.batch_glob = argv[++i];
+        else if (std::strcmp(arg, "--batch-output") == 0 && has_value)
+            opts.batch_output_dir = argv[++i];
+        else if (std::strcmp(arg, "--jobs") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.batch_jobs = n;
+        }
+        else if (std::strcmp(arg, "--batch-memory-mb") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.batch_memory_mb = n;
+        }
+        else if (std::strcmp(arg, "--emit-interval-ns") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.emit.mode = EmitMode::INTERVAL;
+            opts.emit.interval_ns = n;
+            ++emit_modes;
+        }
+        else if (std::strcmp(arg, "--emit-agg") == 0 && has_value && std::strcmp(argv[i + 1], "last") == 0)
+        {
+            opts.emit.aggregation = BucketAggregation::LAST;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--emit-agg") == 0 && has_value && std::strcmp(argv[i + 1], "ohlc") == 0)
+        {
+            opts.emit.aggregation = BucketAggregation::OHLC;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--emit-every") == 0 && has_value)
+        {
+            if (!parse_count(arg, argv[++i], n))
+                return false;
+            opts.emit.mode = EmitMode::EVERY_EVENTS;
+            opts.emit.every_events = std::max<uint64_t>(1, n);
+            ++emit_modes;
+        }
+        else if (std::strcmp(arg, "--emit-on-top-change") == 0)
+        {
+            opts.emit.mode = EmitMode::TOP_CHANGE;
+            ++emit_modes;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    if (opts.pipeline && (opts.checkpoint_every > 0 || !opts.checkpoint_at.empty()))
+    {
+        std::cerr << "Checkpoints are taken on the sequential streaming path; drop --pipeline to write them\n";
+        return false;
+    }
+    if (opts.pipeline && opts.verify_metrics)
+    {
+        std::cerr << "Metrics are verified on the batch and sequential streaming paths; drop --pipeline to verify them\n";
+        return false;
+    }
+    if (opts.batch() && (opts.pipeline || !opts.shm_name.empty() || !opts.l2_feed_filepath.empty() ||
+                         opts.checkpoint_every > 0 || !opts.checkpoint_at.empty() || !opts.restore_filepath.empty() ||
+                         !opts.input_bin_filepath.empty()))
+    {
+        std::cerr << "Batch runs replay each day on its own; --pipeline, --shm, --l2-feed, --input-bin and "
+                     "checkpoints are per-run options\n";
+        return false;
+    }
+    if (emit_modes > 1)
+    {
+        std::cerr << "Choose one of --emit-interval-ns, --emit-every and --emit-on-top-change\n";
+        return false;
+    }
+    if (opts.emit.mode == EmitMode::INTERVAL && opts.emit.interval_ns == 0)
+    {
+        std::cerr << "--emit-interval-ns needs a positive interval\n";
+        return false;
+    }
+    if (opts.emit.aggregation == BucketAggregation::OHLC && opts.emit.mode != EmitMode::INTERVAL)
+    {
+        std::cerr << "--emit-agg ohlc aggregates --emit-interval-ns windows\n";
+        return false;
+    }
+    if (opts.emit.sampled() && (opts.pipeline || opts.verify_metrics))
+    {
+        std::cerr << "Sampled emission runs on the batch and sequential streaming paths and has no per-event rows "
+                     "to verify; drop --pipeline and --verify-metrics\n";
+        return false;
+    }
+    if (opts.emit.sampled() && (opts.checkpoint_every > 0 || !opts.checkpoint_at.empty() || !opts.restore_filepath.empty()))
+    {
+        std::cerr << "Checkpoints do not carry sampled emission windows; drop --emit-* to checkpoint or restore\n";
+        return false;
+    }
+    std::sort(opts.checkpoint_at.begin(), opts.checkpoint_at.end());
+    return true;
+}
+
+void print_report(std::ostream &report, const OrderBook &book, const LOBMetrics &metrics, uint64_t token)
+{
+    report << "\n\n--- Token " << token << " event at " << Utils::format_timestamp_ist(metrics.timestamp_raw) << " ---\n";
+    print_depth(report, book.get_bids_depth(10), book.get_asks_depth(10));
+    report << "\n--- Metrics ---\n";
+    report << std::fixed << std::setprecision(4)
+           << "Mid-Price: " << metrics.mid_price / 100.0
+           << " | Spread: " << metrics.spread / 100.0
+           << " | OFI_Top: " << metrics.ofi_top
+           << " | OFI_Depth: " << metrics.ofi_depth << "\n";
+}
+
+void print_book_summary(std::ostream &out, const BookManager &books, bool trade_driven)
+{
+    for (uint64_t token : books.tokens())
+    {
+        const OrderBook *book = books.find_book(token);
+        OrderPoolStats pool = book->pool_stats();
+        out << "Token " << token << ": book snapshots retained (latest " << book->get_snapshots().size() << ")"
+                  << ", order pool high-water " << pool.high_water << "/" << pool.capacity
+                  << " (grew " << pool.grow_count << "x)" << std::endl;
+        if (trade_driven)
+        {
+            const ReconcileStats &rec = book->reconcile_stats();
+            out << "  trades " << rec.trades << " matched, " << rec.unmatched_trades << " unmatched, "
+                      << rec.anonymous_trades << " without order ids: " << rec.fills
+                      << " fills (" << rec.orders_filled << " orders completed), " << rec.unknown_order
+                      << " unknown order ids, " << rec.overfills << " overfills (" << rec.overfill_quantity
+                      << " qty)" << std::endl;
+        }
+    }
+}
+
+// Latency histograms exist only in LOB_LATENCY_STATS builds
+void print_latency_summary()
+{
+#ifdef LOB_LATENCY_STATS
+    LatencyRegistry::dump(std::cout);
 #endif
+}
+
+OrderBookConfig book_config(const SimOptions &opts)
+{
+    OrderBookConfig config;
+    if (opts.trade_driven)
+        config.matching = MatchingMode::TRADE_DRIVEN;
+    return config;
+}
 
-    std::vector<Event> all_events;
-    std::string line;
+const int SNAPSHOT_FREQ = 1000;
+const int DEPTH_LEVELS = 5;
+const double DECAY_LAMBDA = 0.5;
+
+// One change-driven calculator per token; the map owns them and they stay
+// attached to their book for the whole run.
+using TokenCalculators = std::map<uint64_t, std::unique_ptr<IncrementalMetricsCalculator>>;
+
+IncrementalMetricsCalculator &calculator_for(TokenCalculators &calculators, BookManager &books, uint64_t token)
+{
+    std::unique_ptr<IncrementalMetricsCalculator> &calc = calculators[token];
+    if (!calc)
+        calc.reset(new IncrementalMetricsCalculator(books.book(token), DEPTH_LEVELS, DECAY_LAMBDA));
+    return *calc;
+}
+
+// Sampled emission: one emitter per token, used instead of the calculators
+using TokenEmitters = std::map<uint64_t, std::unique_ptr<MetricsEmitter>>;
+
+MetricsEmitter &emitter_for(TokenEmitters &emitters, BookManager &books, uint64_t token, const SimOptions &opts)
+{
+    std::unique_ptr<MetricsEmitter> &emitter = emitters[token];
+    if (!emitter)
+        emitter.reset(new MetricsEmitter(books.book(token), token, opts.emit, DEPTH_LEVELS, DECAY_LAMBDA));
+    return *emitter;
+}
 
-    // Read order events
-    std::ifstream order_file(order_filepath);
-    if (!order_file.is_open())
+void print_emit_summary(std::ostream &out, const SimOptions &opts, uint64_t emitted, uint64_t events)
+{
+    out << "Emitted " << emitted << (opts.emit.bars() ? " bar(s)" : " row(s)") << " for " << events << " events" << std::endl;
+}
+
+// Per-token L2 feed publisher; batch mode also buffers its records so the
+// feed file is grouped by token like the metrics rows
+struct TokenFeed
+{
+    std::unique_ptr<L2FeedPublisher> publisher;
+    std::vector<L2Record> records;
+};
+using TokenFeeds = std::map<uint64_t, TokenFeed>;
+
+TokenFeed &feed_for(TokenFeeds &feeds, BookManager &books, uint64_t token, const SimOptions &opts)
+{
+    TokenFeed &feed = feeds[token];
+    if (!feed.publisher)
+        feed.publisher.reset(new L2FeedPublisher(books.book(token), token, opts.l2_refresh_events));
+    return feed;
+}
+
+bool open_l2_feed(const SimOptions &opts, L2FeedWriter &writer)
+{
+    std::string error;
+    if (opts.l2_feed_filepath.empty() || writer.open(opts.l2_feed_filepath, error))
+        return true;
+    std::cerr << "FATAL ERROR: " << error << std::endl;
+    return false;
+}
+
+void close_l2_feed(const SimOptions &opts, L2FeedWriter &writer, std::ostream &out)
+{
+    if (opts.l2_feed_filepath.empty())
+        return;
+    if (!writer.close())
+        std::cerr << "ERROR: writing " << opts.l2_feed_filepath << " failed" << std::endl;
+    else
+        out << "Wrote " << writer.records_written() << " L2 feed records to " << opts.l2_feed_filepath << std::endl;
+}
+
+// Shared-memory top of book; a no-op unless --shm was given
+class ShmTop
+{
+public:
+    bool open(const SimOptions &opts)
     {
-        std::cerr << "FATAL ERROR: Could not open order file at " << order_filepath << std::endl;
-        return 1;
+        if (opts.shm_name.empty())
+            return true;
+        std::string error;
+        if (!publisher_.open(opts.shm_name, opts.shm_max_tokens, error))
+        {
+            std::cerr << "FATAL ERROR: " << error << std::endl;
+            return false;
+        }
+        every_ = opts.shm_every;
+        enabled_ = true;
+        return true;
     }
-    std::getline(order_file, line); // Skip header
-    while (std::getline(order_file, line))
+
+    // Single-threaded; call before the token's events are replayed
+    void attach(uint64_t token)
     {
-        Event e = Utils::parse_line(line, false);
-        if (e.timestamp > 0)
-            all_events.push_back(e);
+        if (!enabled_ || slots_.find(token) != slots_.end())
+            return;
+        Slot &slot = slots_[token];
+        slot.index = publisher_.attach(token);
+        if (slot.index < 0)
+            std::cerr << "WARNING: no shared-memory slot left for token " << token << std::endl;
     }
-    order_file.close();
 
-    // Read trade events
-    std::ifstream trade_file(trade_filepath);
-    if (!trade_file.is_open())
+    // seq is the event's index within its token. Each token's slot is only
+    // touched by the thread replaying that token.
+    void on_event(const OrderBook &book, const Event &event, size_t seq)
     {
-        std::cerr << "FATAL ERROR: Could not open trade file at " << trade_filepath << std::endl;
-        return 1;
+        if (!enabled_)
+            return;
+        Slot &slot = slots_.find(event.token)->second;
+        slot.last_timestamp = event.timestamp;
+        if ((seq + 1) % every_ == 0)
+            publisher_.publish(slot.index, book, event.timestamp, seq + 1);
     }
-    std::getline(trade_file, line); // Skip header
-    while (std::getline(trade_file, line))
+
+    // Final state of every book, whatever the publish interval
+    void flush(const BookManager &books)
     {
-        Event e = Utils::parse_line(line, true);
-        if (e.timestamp > 0)
-            all_events.push_back(e);
+        if (!enabled_)
+            return;
+        for (const auto &slot : slots_)
+        {
+            const OrderBook *book = books.find_book(slot.first);
+            if (book)
+                publisher_.publish(slot.second.index, *book, slot.second.last_timestamp, books.events_processed(slot.first));
+        }
     }
-    trade_file.close();
 
-    std::cout << "Loaded " << all_events.size() << " total events. Sorting..." << std::endl;
-    std::sort(all_events.begin(), all_events.end(), [](const Event &a, const Event &b)
-              { return a.timestamp < b.timestamp; });
+private:
+    struct Slot
+    {
+        int index = -1;
+        uint64_t last_timestamp = 0;
+    };
 
-    std::cout << "Processing events and collecting metrics...\n";
+    ShmBookPublisher publisher_;
+    std::map<uint64_t, Slot> slots_;
+    uint64_t every_ = 1;
+    bool enabled_ = false;
+};
 
-    OrderBook book;
-    std::ofstream metrics_out(metrics_filepath);
-    metrics_out << "Timestamp,TimestampRaw,MidPrice,Spread,OFI_Top,OFI_Depth";
-    for (int lvl = 1; lvl <= 5; ++lvl)
+// Total bytes of the replay input; stored in checkpoints so a resume against
+// different files is refused
+uint64_t input_size(const SimOptions &opts)
+{
+    std::vector<std::string> paths;
+    if (!opts.input_bin_filepath.empty())
+        paths.push_back(opts.input_bin_filepath);
+    else
+        paths = {opts.order_filepath, opts.trade_filepath};
+    uint64_t total = 0;
+    for (const auto &path : paths)
     {
-        metrics_out << ",BidLvl" << lvl << ",AskLvl" << lvl;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (file.is_open())
+            total += static_cast<uint64_t>(file.tellg());
     }
-    metrics_out << "\n";
+    return total;
+}
 
-    const int SNAPSHOT_FREQ = 1000;
-    for (size_t i = 0; i < all_events.size(); ++i)
+bool same_metrics(const LOBMetrics &a, const LOBMetrics &b)
+{
+    return a.mid_price == b.mid_price && a.spread == b.spread && a.ofi_top == b.ofi_top &&
+           a.ofi_depth == b.ofi_depth && a.depth_bids == b.depth_bids && a.depth_asks == b.depth_asks;
+}
+
+void print_verify_summary(std::ostream &out, uint64_t rows, uint64_t unchanged, uint64_t mismatches)
+{
+    out << "Metrics: " << unchanged << " of " << rows << " rows unchanged since the previous event";
+    out << "; verify found " << mismatches << " mismatch(es) against a full recompute" << std::endl;
+}
+
+// Loads everything, then replays tokens in parallel. Rows are grouped by
+// token so the file does not depend on the worker count.
+int run_batch(const SimOptions &opts, std::ostream &out, std::ostream &err)
+{
+    EventStore all_events;
+    IngestStats ingest_stats;
+    if (!opts.input_bin_filepath.empty())
+    {
+        // Pre-sorted binary capture: no parsing, no merge
+        EventFileReader reader;
+        std::string error;
+        if (!reader.open(opts.input_bin_filepath, error))
+        {
+            err << "FATAL ERROR: " << error << std::endl;
+            return 1;
+        }
+        if (!reader.read_all(all_events, error))
+        {
+            err << "FATAL ERROR: " << opts.input_bin_filepath << ": " << error << std::endl;
+            return 1;
+        }
+    }
+    else
     {
-        const auto &event = all_events[i];
-        book.process_event(event);
+        // Parse both files in parallel chunks and merge them into replay order
+        ThreadPool ingest_pool(opts.replay_workers);
+        std::string failed_path;
+        std::vector<CsvSource> sources = {{opts.order_filepath, false}, {opts.trade_filepath, true}};
+        if (!Ingest::load_sorted(sources, ingest_pool, all_events, ingest_stats, failed_path))
+        {
+            err << "FATAL ERROR: Could not open input file at " << failed_path << std::endl;
+            return 1;
+        }
+    }
+    if (ingest_stats.corrupt + ingest_stats.unknown_type > 0)
+        ingest_stats.report(err);
+
+    out << "Loaded " << all_events.size() << " total events in timestamp order." << std::endl;
 
-        LOBMetrics metrics = MetricsCalculator::calculate(book, event.timestamp, 5, 0.5);
+    out << "Processing events and collecting metrics...\n";
+
+    BookManager books(opts.replay_workers, book_config(opts));
+
+    // One row buffer and calculator per token, created up front so workers
+    // never mutate the maps; rows are written out in token order once the
+    // replay has finished.
+    std::map<uint64_t, MetricsColumns> token_rows;
+    std::map<uint64_t, std::vector<MetricsBar>> token_bars;
+    TokenCalculators calculators;
+    TokenEmitters emitters;
+    bool sampling = opts.emit.sampled();
+    TokenFeeds feeds;
+    bool feeding = !opts.l2_feed_filepath.empty();
+    ShmTop shm_top;
+    if (!shm_top.open(opts))
+        return 1;
+    for (uint64_t token : all_events.tokens())
+    {
+        token_rows[token];
+        token_bars[token];
+        if (sampling)
+            emitter_for(emitters, books, token, opts);
+        else
+            calculator_for(calculators, books, token);
+        if (feeding)
+            feed_for(feeds, books, token, opts);
+        shm_top.attach(token);
+    }
 
-        if (i % SNAPSHOT_FREQ == 0)
+    std::mutex console_mutex;
+    std::atomic<uint64_t> unchanged_rows(0), mismatches(0);
+    auto report = [&](const OrderBook &book, const LOBMetrics &metrics, uint64_t token)
+    {
+        std::ostringstream text;
+        print_report(text, book, metrics, token);
+        std::lock_guard<std::mutex> lock(console_mutex);
+        out << text.str();
+    };
+    // Runs on the token's worker; only that token's buffers are touched
+    auto collect = [&](MetricsEmitter &emitter, uint64_t token, MetricsEmitter::Emitted emitted)
+    {
+        if (emitted == MetricsEmitter::Emitted::ROW)
+            token_rows.find(token)->second.append(emitter.row(), token);
+        else if (emitted == MetricsEmitter::Emitted::BAR)
+            token_bars.find(token)->second.push_back(emitter.bar());
+    };
+    BookManager::EventHandler before_event;
+    if (sampling)
+        before_event = [&](OrderBook &, const Event &event, size_t)
         {
-            std::cout << "\n\n--- Event at " << metrics.timestamp_formatted << " ---\n";
-            print_depth(book.get_bids_depth(10), book.get_asks_depth(10));
-            std::cout << "\n--- Metrics ---\n";
-            std::cout << std::fixed << std::setprecision(4)
-                      << "Mid-Price: " << metrics.mid_price / 100.0
-                      << " | Spread: " << metrics.spread / 100.0
-                      << " | OFI_Top: " << metrics.ofi_top
-                      << " | OFI_Depth: " << metrics.ofi_depth << "\n";
+            MetricsEmitter &emitter = *emitters.find(event.token)->second;
+            collect(emitter, event.token, emitter.before_event(event));
+        };
+    books.replay(all_events, [&](OrderBook &book, const Event &event, size_t seq)
+                 {
+        if (sampling)
+        {
+            MetricsEmitter &emitter = *emitters.find(event.token)->second;
+            collect(emitter, event.token, emitter.after_event(event, seq));
+            if (seq % SNAPSHOT_FREQ == 0)
+                report(book, MetricsCalculator::calculate(book, event.timestamp, DEPTH_LEVELS, DECAY_LAMBDA, false),
+                       event.token);
         }
+        else
+        {
+            const LOBMetrics &metrics = calculators.find(event.token)->second->calculate(event.timestamp, false);
+            if (metrics.unchanged)
+                unchanged_rows.fetch_add(1, std::memory_order_relaxed);
+            if (opts.verify_metrics &&
+                !same_metrics(metrics, MetricsCalculator::calculate(book, event.timestamp, DEPTH_LEVELS, DECAY_LAMBDA, false)))
+                mismatches.fetch_add(1, std::memory_order_relaxed);
 
-        metrics_out << metrics.timestamp_formatted << ","
-                    << metrics.timestamp_raw << ","
-                    << metrics.mid_price << ","
-                    << metrics.spread << ","
-                    << metrics.ofi_top << ","
-                    << metrics.ofi_depth;
+            if (seq % SNAPSHOT_FREQ == 0)
+                report(book, metrics, event.token);
 
-        for (size_t lvl = 0; lvl < 5; ++lvl)
+            token_rows.find(event.token)->second.append(metrics, event.token);
+        }
+        if (feeding)
         {
-            metrics_out << ",";
-            metrics_out << ((lvl < metrics.depth_bids.size()) ? metrics.depth_bids[lvl] : 0);
-            metrics_out << ",";
-            metrics_out << ((lvl < metrics.depth_asks.size()) ? metrics.depth_asks[lvl] : 0);
+            TokenFeed &feed = feeds.find(event.token)->second;
+            feed.publisher->publish(event.timestamp, feed.records);
         }
-        metrics_out << "\n";
+        shm_top.on_event(book, event, seq);
 
-        if (i % SNAPSHOT_FREQ == 0)
+        if (seq % SNAPSHOT_FREQ == 0)
         {
             book.take_snapshot(event.timestamp);
+        } }, before_event);
+    shm_top.flush(books);
+    for (auto &emitter : emitters)
+        collect(*emitter.second, emitter.first, emitter.second->finish());
+
+    uint64_t emitted = 0;
+    std::string error;
+    if (opts.emit.bars())
+    {
+        std::unique_ptr<BarWriter> writer = BarWriter::create(opts.output_format);
+        if (!writer->open(opts.output_path(), error))
+        {
+            err << "FATAL ERROR: " << error << std::endl;
+            return 1;
+        }
+        for (const auto &bars : token_bars)
+        {
+            for (const auto &bar : bars.second)
+                writer->write(bar);
+            emitted += bars.second.size();
         }
+        if (!writer->close())
+            err << "ERROR: writing " << opts.output_path() << " failed" << std::endl;
+    }
+    else
+    {
+        std::unique_ptr<MetricsWriter> writer = MetricsWriter::create(opts.output_format);
+        if (!writer->open(opts.output_path(), error))
+        {
+            err << "FATAL ERROR: " << error << std::endl;
+            return 1;
+        }
+        for (const auto &rows : token_rows)
+        {
+            writer->write(rows.second);
+            emitted += rows.second.size();
+        }
+        if (!writer->close())
+            err << "ERROR: writing " << opts.output_path() << " failed" << std::endl;
     }
 
-    metrics_out.close();
-    std::cout << "\nSimulation finished. Metrics data saved to " << metrics_filepath << std::endl;
-    std::cout << "Book snapshots retained (latest " << book.get_snapshots().size() << ")" << std::endl;
+    L2FeedWriter feed_writer;
+    if (!open_l2_feed(opts, feed_writer))
+        return 1;
+    for (const auto &feed : feeds)
+        feed_writer.write(feed.second.records);
+    close_l2_feed(opts, feed_writer, out);
 
+    out << "\nSimulation finished. Metrics data saved to " << opts.output_path() << std::endl;
+    out << "Replayed " << books.book_count() << " token(s) on " << books.worker_count() << " worker thread(s)" << std::endl;
+    if (sampling)
+        print_emit_summary(out, opts, emitted, all_events.size());
+    if (opts.verify_metrics)
+        print_verify_summary(out, all_events.size(), unchanged_rows.load(), mismatches.load());
+    print_book_summary(out, books, opts.trade_driven);
     return 0;
 }
+
+// Reads, merges and replays incrementally on one thread; memory stays flat
+// and rows are written in replay order as soon as each event is applied.
+int run_streaming(const SimOptions &opts, std::ostream &out, std::ostream &err)
+{
+    EventStream stream({{opts.order_filepath, false}, {opts.trade_filepath, true}}, opts.reorder_window_ns);
+    EventFileReader reader;
+    size_t next_record = 0;
+    bool from_bin = !opts.input_bin_filepath.empty();
+    std::string error;
+    if (from_bin ? !reader.open(opts.input_bin_filepath, error) : !stream.open(error))
+    {
+        err << "FATAL ERROR: " << (from_bin ? error : "Could not open input file at " + error) << std::endl;
+        return 1;
+    }
+    auto next_event = [&](Event &event)
+    {
+        if (!from_bin)
+            return stream.next(event);
+        if (next_record == reader.size())
+            return false;
+        event = reader.event(next_record++);
+        return true;
+    };
+
+    out << "Streaming events and collecting metrics...\n";
+
+    BookManager books(1, book_config(opts));
+
+    // Resume: restore every book, then skip the input the checkpoint covers.
+    // Nothing is attached to the books yet, which load_checkpoint requires.
+    uint64_t consumed = 0;
+    uint64_t last_timestamp = 0;
+    size_t next_checkpoint_at = 0;
+    uint64_t this_input_size = input_size(opts);
+    if (!opts.restore_filepath.empty())
+    {
+        CheckpointInfo info;
+        if (!books.load_checkpoint(opts.restore_filepath, info, error))
+        {
+            err << "FATAL ERROR: " << error << std::endl;
+            return 1;
+        }
+        if (info.input_size != this_input_size)
+        {
+            err << "FATAL ERROR: " << opts.restore_filepath << " was taken on different input files" << std::endl;
+            return 1;
+        }
+        // A capture is indexed by event, so it resumes in place. The CSV
+        // merge has to re-read the covered prefix: its reorder window holds
+        // events from past the checkpoint, so no file offset resumes it
+        // exactly. Skipped events are parsed but never reach a book.
+        if (from_bin)
+            consumed = next_record = std::min<uint64_t>(info.input_offset, reader.size());
+        Event skipped;
+        while (consumed < info.input_offset && next_event(skipped))
+            ++consumed;
+        if (consumed < info.input_offset)
+        {
+            err << "FATAL ERROR: input ends before the checkpoint offset " << info.input_offset << std::endl;
+            return 1;
+        }
+        last_timestamp = info.timestamp;
+        while (next_checkpoint_at < opts.checkpoint_at.size() && opts.checkpoint_at[next_checkpoint_at] < last_timestamp)
+            ++next_checkpoint_at;
+        out << "Restored " << books.book_count() << " book(s) from " << opts.restore_filepath
+                  << ", resuming after event " << consumed << std::endl;
+    }
+    auto save_checkpoint = [&]()
+    {
+        std::string path = Checkpoint::file_name(opts.checkpoint_dir, consumed);
+        std::string ckpt_error;
+        if (books.save_checkpoint(path, {consumed, last_timestamp, this_input_size}, ckpt_error))
+            out << "Checkpoint after event " << consumed << " written to " << path << std::endl;
+        else
+            err << "ERROR: checkpoint failed: " << ckpt_error << std::endl;
+    };
+
+    // OHLC bars take the place of the metrics rows
+    std::unique_ptr<MetricsWriter> writer;
+    std::unique_ptr<BarWriter> bar_writer;
+    bool opened;
+    if (opts.emit.bars())
+    {
+        bar_writer = BarWriter::create(opts.output_format);
+        opened = bar_writer->open(opts.output_path(), error);
+    }
+    else
+    {
+        // Checkpoints are only taken with one row per event, so a resumed run
+        // keeps the first `consumed` rows of the interrupted run's output and
+        // continues it
+        writer = MetricsWriter::create(opts.output_format);
+        opened = opts.restore_filepath.empty() ? writer->open(opts.output_path(), error)
+                                               : writer->resume(opts.output_path(), consumed, error);
+    }
+    if (!opened)
+    {
+        err << "FATAL ERROR: " << error << std::endl;
+        return 1;
+    }
+
+    // L2 feed records go out as soon as each event is applied
+    L2FeedWriter feed_writer;
+    if (!open_l2_feed(opts, feed_writer))
+        return 1;
+    bool feeding = !opts.l2_feed_filepath.empty();
+    TokenFeeds feeds;
+    std::vector<L2Record> feed_records;
+    ShmTop shm_top;
+    if (!shm_top.open(opts))
+        return 1;
+    auto publish_l2 = [&](const Event &event)
+    {
+        feed_for(feeds, books, event.token, opts).publisher->publish(event.timestamp, feed_records);
+        feed_writer.write(feed_records);
+        feed_records.clear();
+    };
+
+    std::unique_ptr<ReplayPipeline> pipeline;
+    if (opts.pipeline)
+    {
+        // Ingest, book updates, metrics and output on their own threads;
+        // the L2 feed is published from the book stage
+        pipeline.reset(new ReplayPipeline(books, *writer));
+        pipeline->run(next_event, [&](OrderBook &book, const Event &event, size_t seq)
+                      {
+            if (feeding)
+                publish_l2(event);
+            shm_top.attach(event.token);
+            shm_top.on_event(book, event, seq);
+            if (seq % SNAPSHOT_FREQ == 0)
+            {
+                print_report(out, book, MetricsCalculator::calculate(book, event.timestamp, DEPTH_LEVELS, DECAY_LAMBDA, false),
+                             event.token);
+                book.take_snapshot(event.timestamp);
+            } });
+    }
+
+    TokenCalculators calculators;
+    TokenEmitters emitters;
+    bool sampling = opts.emit.sampled();
+    uint64_t rows = 0, unchanged_rows = 0, mismatches = 0, emitted = 0;
+    auto emit = [&](MetricsEmitter &emitter, uint64_t token, MetricsEmitter::Emitted what)
+    {
+        if (what == MetricsEmitter::Emitted::ROW)
+            writer->write(emitter.row(), token);
+        else if (what == MetricsEmitter::Emitted::BAR)
+            bar_writer->write(emitter.bar());
+        if (what != MetricsEmitter::Emitted::NOTHING)
+            ++emitted;
+    };
+    Event event;
+    while (!pipeline && next_event(event))
+    {
+        // Timestamp checkpoints are cut before the first event past them
+        while (next_checkpoint_at < opts.checkpoint_at.size() && opts.checkpoint_at[next_checkpoint_at] < event.timestamp)
+        {
+            if (consumed > 0)
+                save_checkpoint();
+            ++next_checkpoint_at;
+        }
+
+        size_t seq = books.events_processed(event.token);
+        MetricsEmitter *emitter = nullptr;
+        IncrementalMetricsCalculator *calc = nullptr;
+        if (sampling)
+        {
+            emitter = &emitter_for(emitters, books, event.token, opts);
+            emit(*emitter, event.token, emitter->before_event(event));
+        }
+        else
+            calc = &calculator_for(calculators, books, event.token);
+        if (feeding)
+            feed_for(feeds, books, event.token, opts);
+        shm_top.attach(event.token);
+        OrderBook &book = books.process_event(event);
+        if (feeding)
+            publish_l2(event);
+        shm_top.on_event(book, event, seq);
+        if (emitter)
+        {
+            emit(*emitter, event.token, emitter->after_event(event, seq));
+            if (seq % SNAPSHOT_FREQ == 0)
+                print_report(out, book, MetricsCalculator::calculate(book, event.timestamp, DEPTH_LEVELS, DECAY_LAMBDA, false),
+                             event.token);
+        }
+        else
+        {
+            const LOBMetrics &metrics = calc->calculate(event.timestamp, false);
+            ++rows;
+            if (metrics.unchanged)
+                ++unchanged_rows;
+            if (opts.verify_metrics &&
+                !same_metrics(metrics, MetricsCalculator::calculate(book, event.timestamp, DEPTH_LEVELS, DECAY_LAMBDA, false)))
+                ++mismatches;
+
+            if (seq % SNAPSHOT_FREQ == 0)
+                print_report(out, book, metrics, event.token);
+
+            writer->write(metrics, event.token);
+        }
+
+        if (seq % SNAPSHOT_FREQ == 0)
+        {
+            book.take_snapshot(event.timestamp);
+        }
+
+        ++consumed;
+        last_timestamp = event.timestamp;
+        if (opts.checkpoint_every > 0 && consumed % opts.checkpoint_every == 0)
+            save_checkpoint();
+    }
+    shm_top.flush(books);
+    for (auto &e : emitters)
+        emit(*e.second, e.first, e.second->finish());
+    if (writer ? !writer->close() : !bar_writer->close())
+        err << "ERROR: writing " << opts.output_path() << " failed" << std::endl;
+    close_l2_feed(opts, feed_writer, out);
+
+    const IngestStats &ingest_stats = stream.stats();
+    if (ingest_stats.corrupt + ingest_stats.unknown_type > 0)
+        ingest_stats.report(err);
+    out << "\nSimulation finished. Metrics data saved to " << opts.output_path() << std::endl;
+    if (from_bin)
+        out << "Streamed " << reader.size() << " events from " << opts.input_bin_filepath << std::endl;
+    else
+        out << "Streamed " << ingest_stats.events << " events (peak " << stream.peak_buffered()
+                  << " buffered, " << stream.late_events() << " beyond the reorder window)" << std::endl;
+    if (sampling)
+        print_emit_summary(out, opts, emitted, consumed);
+    if (pipeline)
+        pipeline->report(out);
+    else if (opts.verify_metrics)
+        print_verify_summary(out, rows, unchanged_rows, mismatches);
+    print_book_summary(out, books, opts.trade_driven);
+    return 0;
+}
+
+// Replays every day of a manifest or glob, each as an ordinary batch (or,
+// with --stream, streaming) run with one thread. A day's metrics go where
+// its job says and its console output, errors and diagnostics to
+// <output>.log, so every file is the same whatever --jobs is.
+int run_many(const SimOptions &opts)
+{
+    std::vector<BatchJob> jobs;
+    std::string error;
+    bool listed = opts.manifest_filepath.empty()
+                      ? BatchRunner::expand_glob(opts.batch_glob, opts.batch_output_dir, jobs, error)
+                      : BatchRunner::read_manifest(opts.manifest_filepath, jobs, error);
+    if (!listed)
+    {
+        std::cerr << "FATAL ERROR: " << error << std::endl;
+        return 1;
+    }
+#if __cplusplus >= 201703L
+    if (opts.manifest_filepath.empty() && !opts.batch_output_dir.empty() && !fs::exists(opts.batch_output_dir))
+        fs::create_directories(opts.batch_output_dir);
+#endif
+
+    // Glob outputs are named for CSV; npy output is a directory per day
+    if (opts.manifest_filepath.empty() && opts.output_format == OutputFormat::NPY)
+        for (auto &job : jobs)
+            job.output_filepath.erase(job.output_filepath.rfind('.'));
+
+    std::cout << "Replaying " << jobs.size() << " day(s)..." << std::endl;
+    std::vector<BatchResult> results = BatchRunner::run(jobs, opts.batch_jobs, opts.batch_memory_mb << 20, opts.streaming,
+                                                        [&](const BatchJob &job)
+                                                        {
+        SimOptions day = opts;
+        day.order_filepath = job.order_filepath;
+        day.trade_filepath = job.trade_filepath;
+        day.metrics_filepath = job.output_filepath;
+        day.replay_workers = 1;
+        std::ofstream log(job.output_filepath + ".log");
+        DiagnosticsBuffer day_diagnostics;
+        DiagnosticsSinkScope scope(&day_diagnostics);
+        int status = day.streaming ? run_streaming(day, log, log) : run_batch(day, log, log);
+        day_diagnostics.report(log);
+        return status; });
+
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        std::cout << "[" << i + 1 << "/" << jobs.size() << "] " << jobs[i].order_filepath << " -> " << jobs[i].output_filepath;
+        if (results[i].status == 0)
+            std::cout << std::fixed << std::setprecision(2) << " (" << results[i].seconds << " s)" << std::endl;
+        else
+        {
+            std::cout << " FAILED (status " << results[i].status << ")" << std::endl;
+            ++failed;
+        }
+    }
+    std::cout << jobs.size() - failed << " of " << jobs.size() << " day(s) replayed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions opts;
+    if (!parse_args(argc, argv, opts))
+        return 1;
+
+#ifdef LOB_LATENCY_STATS
+    // kill -USR1 <pid> prints the latency summary mid-run
+    LatencySignalDump latency_dump;
+    latency_dump.start();
+#endif
+
+#if __cplusplus >= 201703L
+    // Create the Output directory if it does not exist (C++17 only)
+    if (!fs::exists("Output"))
+        fs::create_directory("Output");
+#endif
+
+    // Book and parser diagnostics are printed off the hot path, rate limited
+    DiagnosticsDrain diagnostics;
+    diagnostics.start(std::cerr);
+
+    int status;
+    if (opts.batch())
+        status = run_many(opts);
+    else if (opts.streaming)
+        status = run_streaming(opts, std::cout, std::cerr);
+    else
+        status = run_batch(opts, std::cout, std::cerr);
+    print_latency_summary();
+    diagnostics.stop();
+    Diagnostics::report(std::cerr);
+    return status;
+}
@@ -1,11 +1,43 @@
+import os
+import sys
+
+import numpy as np
 import pandas as pd
 import matplotlib.pyplot as plt
 
-# Path to your metrics file
-filepath = 'Output/metrics_output.csv'
+# Path to your metrics output: the CSV file, or the directory written by
+# `lob_sim --format npy`
+filepath = sys.argv[1] if len(sys.argv) > 1 else 'Output/metrics_output.csv'
+if len(sys.argv) == 1 and not os.path.exists(filepath) and os.path.isdir('Output/metrics_columns'):
+    filepath = 'Output/metrics_columns'
+
+# Upper bound on points per series; the columnar path strides down to it
+MAX_POINTS = 200_000
+
+COLUMNS = ['TimestampRaw', 'Token', 'MidPrice', 'Spread', 'OFI_Top', 'OFI_Depth']
+
+
+def load_columns(directory):
+    # np.load with mmap_mode returns numpy.memmap arrays, so only the pages
+    # behind the selected rows are read
+    cols = {name: np.load(os.path.join(directory, name + '.npy'), mmap_mode='r') for name in COLUMNS}
+    tokens, counts = np.unique(cols['Token'], return_counts=True)
+    rows = np.flatnonzero(cols['Token'] == tokens[np.argmax(counts)])
+    step = max(1, len(rows) // MAX_POINTS)
+    rows = rows[::step]
+    return pd.DataFrame({name: np.asarray(col[rows]) for name, col in cols.items()})
+
 
 # Load the data
-df = pd.read_csv(filepath)
+if os.path.isdir(filepath):
+    df = load_columns(filepath)
+else:
+    df = pd.read_csv(filepath)
+
+    # Rows are grouped per instrument token; plot the most active one
+    if 'Token' in df.columns:
+        token = df['Token'].value_counts().idxmax()
+        df = df[df['Token'] == token]
 
 # Convert 'MidPrice' and 'Spread' to rupees if in paise
 df['MidPrice'] = df['MidPrice'] / 100.0